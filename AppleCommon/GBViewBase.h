@@ -9,14 +9,6 @@
 
 #import <Core/gb.h>
 
-typedef enum {
-    GB_FRAME_BLENDING_MODE_DISABLED,
-    GB_FRAME_BLENDING_MODE_SIMPLE,
-    GB_FRAME_BLENDING_MODE_ACCURATE,
-    GB_FRAME_BLENDING_MODE_ACCURATE_EVEN = GB_FRAME_BLENDING_MODE_ACCURATE,
-    GB_FRAME_BLENDING_MODE_ACCURATE_ODD,
-} GB_frame_blending_mode_t;
-
 @interface GBViewBase : NSView
 {
     @public
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <assert.h>
+#ifdef _WIN32
+#include <windows.h>
+#define snprintf _snprintf
+#endif
+
+#include <Core/gb.h>
+
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
+
+static const char *executable_folder(void)
+{
+    static char path[1024] = {0,};
+    if (path[0]) {
+        return path;
+    }
+    /* Ugly unportable code! :( */
+#ifdef __APPLE__
+    uint32_t length = sizeof(path) - 1;
+    _NSGetExecutablePath(&path[0], &length);
+#else
+#ifdef __linux__
+    size_t __attribute__((unused)) length = readlink("/proc/self/exe", &path[0], sizeof(path) - 1);
+    assert(length != -1);
+#else
+#ifdef _WIN32
+    HMODULE hModule = GetModuleHandle(NULL);
+    GetModuleFileName(hModule, path, sizeof(path) - 1);
+#else
+    /* No OS-specific way, assume running from CWD */
+    getcwd(&path[0], sizeof(path) - 1);
+    return path;
+#endif
+#endif
+#endif
+    size_t pos = strlen(path);
+    while (pos) {
+        pos--;
+#ifdef _WIN32
+        if (path[pos] == '\\') {
+#else
+        if (path[pos] == '/') {
+#endif
+            path[pos] = 0;
+            break;
+        }
+    }
+    return path;
+}
+
+static char *executable_relative_path(const char *filename)
+{
+    static char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", executable_folder(), filename);
+    return path;
+}
+
+static bool has_extension(const char *path, const char *extension)
+{
+    size_t length = strlen(path);
+    size_t extension_length = strlen(extension);
+    if (length < extension_length) return false;
+    path += length - extension_length;
+    for (unsigned i = 0; i < extension_length; i++) {
+        if (tolower((unsigned char)path[i]) != extension[i]) return false;
+    }
+    return true;
+}
+
+static void sample_callback(GB_gameboy_t *gb, GB_sample_t *sample)
+{
+    /* Samples are only consumed by the audio recording */
+}
+
+static char *async_input_callback(GB_gameboy_t *gb)
+{
+    return NULL;
+}
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [--dmg] [--sgb] [--cgb] [--boot path to boot ROM] [--track number] [--length seconds]"
+                    " [--rate sample rate] [--highpass off|accurate|remove-dc] [--stems] input.gbs|vgm|rom output.wav|aiff|raw|vgm\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    GB_model_t model = GB_MODEL_DMG_B;
+    const char *default_boot_rom = "dmg_boot.bin";
+    const char *boot_rom_path = NULL;
+    const char *input = NULL;
+    const char *output = NULL;
+    unsigned track = 0;
+    bool track_set = false;
+    double length = 180;
+    unsigned sample_rate = 44100;
+    GB_highpass_mode_t highpass_mode = GB_HIGHPASS_ACCURATE;
+    bool stems = false;
+
+    for (unsigned i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dmg") == 0) {
+            model = GB_MODEL_DMG_B;
+            default_boot_rom = "dmg_boot.bin";
+        }
+        else if (strcmp(argv[i], "--sgb") == 0) {
+            model = GB_MODEL_SGB2;
+            default_boot_rom = "sgb2_boot.bin";
+        }
+        else if (strcmp(argv[i], "--cgb") == 0) {
+            model = GB_MODEL_CGB_E;
+            default_boot_rom = "cgb_boot.bin";
+        }
+        else if (strcmp(argv[i], "--boot") == 0 && i != argc - 1) {
+            boot_rom_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--track") == 0 && i != argc - 1) {
+            track = atoi(argv[++i]);
+            track_set = true;
+            if (track == 0) {
+                fprintf(stderr, "Track numbers start at 1\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--length") == 0 && i != argc - 1) {
+            length = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--rate") == 0 && i != argc - 1) {
+            sample_rate = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--highpass") == 0 && i != argc - 1) {
+            i++;
+            if (strcmp(argv[i], "off") == 0) {
+                highpass_mode = GB_HIGHPASS_OFF;
+            }
+            else if (strcmp(argv[i], "accurate") == 0) {
+                highpass_mode = GB_HIGHPASS_ACCURATE;
+            }
+            else if (strcmp(argv[i], "remove-dc") == 0) {
+                highpass_mode = GB_HIGHPASS_REMOVE_DC_OFFSET;
+            }
+            else {
+                fprintf(stderr, "Unknown highpass mode %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--stems") == 0) {
+            stems = true;
+        }
+        else if (!input) {
+            input = argv[i];
+        }
+        else if (!output) {
+            output = argv[i];
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!input || !output || length <= 0 || sample_rate == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool vgm_output = has_extension(output, ".vgm");
+    GB_audio_format_t format = GB_AUDIO_FORMAT_RAW;
+    if (has_extension(output, ".wav")) {
+        format = GB_AUDIO_FORMAT_WAV;
+    }
+    else if (has_extension(output, ".aiff") || has_extension(output, ".aif") || has_extension(output, ".aifc")) {
+        format = GB_AUDIO_FORMAT_AIFF;
+    }
+
+    static GB_gameboy_t gb;
+    GB_init(&gb, model);
+    GB_set_sample_rate(&gb, sample_rate);
+    GB_apu_set_sample_callback(&gb, sample_callback);
+    GB_set_async_input_callback(&gb, async_input_callback);
+    GB_set_highpass_filter_mode(&gb, highpass_mode);
+    GB_set_turbo_mode(&gb, true, true);
+    GB_set_audio_only_mode(&gb, true);
+
+    if (has_extension(input, ".gbs")) {
+        GB_gbs_info_t info;
+        if (GB_load_gbs(&gb, input, &info)) {
+            fprintf(stderr, "Failed to load GBS file %s\n", input);
+            return 1;
+        }
+        if (track_set) {
+            if (track > info.track_count) {
+                fprintf(stderr, "%s only has %u tracks\n", input, info.track_count);
+                return 1;
+            }
+            GB_gbs_switch_track(&gb, track - 1);
+        }
+        else {
+            track = info.first_track + 1;
+        }
+        fprintf(stderr, "Rendering track %u of %u from %s\n", track, info.track_count, info.title);
+    }
+    else if (has_extension(input, ".vgm")) {
+        if (GB_load_vgm(&gb, input)) {
+            fprintf(stderr, "Failed to load VGM file %s\n", input);
+            return 1;
+        }
+    }
+    else {
+        if (GB_load_boot_rom(&gb, boot_rom_path ?: executable_relative_path(default_boot_rom))) {
+            fprintf(stderr, "Failed to load boot ROM from '%s'\n", boot_rom_path ?: executable_relative_path(default_boot_rom));
+            return 1;
+        }
+        if (GB_load_rom(&gb, input)) {
+            perror("Failed to load ROM");
+            return 1;
+        }
+    }
+
+    int error;
+    if (vgm_output) {
+        error = GB_start_vgm_logging(&gb, output);
+    }
+    else if (stems) {
+        error = GB_start_audio_stem_recording(&gb, output, format);
+    }
+    else {
+        error = GB_start_audio_recording(&gb, output, format);
+    }
+    if (error) {
+        fprintf(stderr, "Failed to create %s: %s\n", output, strerror(error));
+        return 1;
+    }
+
+    /* GB_run returns 8MHz ticks */
+    uint64_t target = length * GB_get_unmultiplied_clock_rate(&gb) * 2;
+    uint64_t cycles = 0;
+    while (cycles < target) {
+        cycles += GB_run(&gb);
+    }
+
+    error = vgm_output? GB_stop_vgm_logging(&gb) : GB_stop_audio_recording(&gb);
+    GB_free(&gb);
+    if (error) {
+        fprintf(stderr, "Failed to write %s: %s\n", output, strerror(error));
+        return 1;
+    }
+    return 0;
+}
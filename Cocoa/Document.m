@@ -85,6 +85,10 @@
     AVCaptureStillImageOutput *_cameraOutput;
     
     GB_oam_info_t _oamInfo[40];
+    NSMutableData *_tilesetData;
+    GB_vram_view_cache_t _tilesetCache;
+    NSMutableData *_tilemapData;
+    GB_vram_view_cache_t _tilemapCache;
     
     NSMutableData *_currentPrinterImageData;
     
@@ -565,8 +569,7 @@ static unsigned *multiplication_table_for_frequency(unsigned frequency)
         while (_running) {
             if (_rewind) {
                 _rewind = false;
-                GB_rewind_pop(&_gb);
-                if (!GB_rewind_pop(&_gb)) {
+                if (GB_rewind_seek(&_gb, 2) < 2) {
                     _rewind = self.view.isRewinding;
                 }
             }
@@ -1972,12 +1975,12 @@ enum GBWindowResizeAction
                 if (palette_menu_index) {
                     palette_type = palette_menu_index > 8? GB_PALETTE_OAM : GB_PALETTE_BACKGROUND;
                 }
-                size_t bufferLength = 256 * 192 * 4;
-                NSMutableData *data = [NSMutableData dataWithCapacity:bufferLength];
-                data.length = bufferLength;
-                GB_draw_tileset(&_gb, (uint32_t *)data.mutableBytes, palette_type, (palette_menu_index - 1) & 7);
+                if (!_tilesetData) {
+                    _tilesetData = [NSMutableData dataWithLength:256 * 192 * 4];
+                }
+                GB_draw_tileset_cached(&_gb, (uint32_t *)_tilesetData.mutableBytes, palette_type, (palette_menu_index - 1) & 7, &_tilesetCache);
                 
-                self.tilesetImageView.image = [Document imageFromData:data width:256 height:192 scale:1.0];
+                self.tilesetImageView.image = [Document imageFromData:_tilesetData width:256 height:192 scale:1.0];
                 self.tilesetImageView.layer.magnificationFilter = kCAFilterNearest;
             }
             break;
@@ -1994,17 +1997,18 @@ enum GBWindowResizeAction
                     palette_type = GB_PALETTE_AUTO;
                 }
                 
-                size_t bufferLength = 256 * 256 * 4;
-                NSMutableData *data = [NSMutableData dataWithCapacity:bufferLength];
-                data.length = bufferLength;
-                GB_draw_tilemap(&_gb, (uint32_t *)data.mutableBytes, palette_type, (palette_menu_index - 2) & 7,
-                                (GB_map_type_t) self.tilemapMapButton.indexOfSelectedItem,
-                                (GB_tileset_type_t) self.TilemapSetButton.indexOfSelectedItem);
+                if (!_tilemapData) {
+                    _tilemapData = [NSMutableData dataWithLength:256 * 256 * 4];
+                }
+                GB_draw_tilemap_cached(&_gb, (uint32_t *)_tilemapData.mutableBytes, palette_type, (palette_menu_index - 2) & 7,
+                                       (GB_map_type_t) self.tilemapMapButton.indexOfSelectedItem,
+                                       (GB_tileset_type_t) self.TilemapSetButton.indexOfSelectedItem,
+                                       &_tilemapCache);
                 
                 self.tilemapImageView.scrollRect = NSMakeRect(io_regs[GB_IO_SCX],
                                                               io_regs[GB_IO_SCY],
                                                               160, 144);
-                self.tilemapImageView.image = [Document imageFromData:data width:256 height:256 scale:1.0];
+                self.tilemapImageView.image = [Document imageFromData:_tilemapData width:256 height:256 scale:1.0];
                 self.tilemapImageView.layer.magnificationFilter = kCAFilterNearest;
             }
             break;
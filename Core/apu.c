@@ -5,15 +5,25 @@
 #include <errno.h>
 #include <stdlib.h>
 #include "gb.h"
+#ifndef GB_DISABLE_THREADS
+#include <pthread.h>
+#endif
 
 /* Band limited synthesis loosely based on: http://www.slack.net/~ant/bl-synth/ */
-static int32_t band_limited_steps[GB_BAND_LIMITED_PHASES][GB_BAND_LIMITED_WIDTH];
+typedef int32_t band_limited_vector_t __attribute__((vector_size(16), aligned(4), may_alias));
 
-static void __attribute__((constructor)) band_limited_init(void)
+/* Returns a table of [GB_BAND_LIMITED_PHASES][width][2] steps, generated on first use and shared by all instances.
+   Every step is stored twice, matching the left/right layout of GB_band_limited_t's buffer. */
+static const int32_t *band_limited_steps(unsigned width)
 {
-    const unsigned master_size = GB_BAND_LIMITED_WIDTH * GB_BAND_LIMITED_PHASES;
+    static const int32_t *tables[GB_BAND_LIMITED_WIDTH + 1];
+    const int32_t *table = __atomic_load_n(&tables[width], __ATOMIC_ACQUIRE);
+    if (likely(table)) return table;
+    
+    const unsigned master_size = width * GB_BAND_LIMITED_PHASES;
     double *master = malloc(master_size  * sizeof(*master));
     memset(master, 0, master_size  * sizeof(*master));
+    int32_t (*steps)[width][2] = malloc(sizeof(*steps) * GB_BAND_LIMITED_PHASES);
     
     const double lowpass = 15.0 / 16.0; // 1.0 means using Nyquist as the exact cutoff
     const double to_angle = M_PI / GB_BAND_LIMITED_PHASES * lowpass;
@@ -36,7 +46,7 @@ static void __attribute__((constructor)) band_limited_init(void)
     
     nounroll for (signed phase = 0; phase < GB_BAND_LIMITED_PHASES; phase++) {
         int32_t error = GB_BAND_LIMITED_ONE;
-        nounroll for (signed i = 0; i < GB_BAND_LIMITED_WIDTH; i++) {
+        nounroll for (signed i = 0; i < width; i++) {
             double sum = 0;
             nounroll for (signed j = 0; j < GB_BAND_LIMITED_PHASES; j++) {
                 signed index = i * GB_BAND_LIMITED_PHASES - phase + j;
@@ -46,16 +56,38 @@ static void __attribute__((constructor)) band_limited_init(void)
             }
             int32_t cur = sum * GB_BAND_LIMITED_ONE;
             error -= cur;
-            band_limited_steps[phase][i] = cur;
+            steps[phase][i][0] = cur;
         }
         
         // Make sure the deltas sum to 1.0
-        band_limited_steps[phase][GB_BAND_LIMITED_WIDTH / 2] += error;
+        steps[phase][width / 2][0] += error;
+        nounroll for (signed i = 0; i < width; i++) {
+            steps[phase][i][1] = steps[phase][i][0];
+        }
     }
     free(master);
+    
+    /* Another thread may have generated the same table in the meantime */
+    if (!__atomic_compare_exchange_n(&tables[width], &table, steps[0][0], false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(steps);
+    }
+    return __atomic_load_n(&tables[width], __ATOMIC_ACQUIRE);
 }
 
-static void band_limited_update(GB_band_limited_t *band_limited, const GB_sample_t *input, unsigned phase)
+static inline void band_limited_add_steps(int32_t *buffer, const int32_t *steps, unsigned taps, band_limited_vector_t delta)
+{
+    unsigned i = 0;
+    for (; i + 2 <= taps; i += 2) {
+        *(band_limited_vector_t *)(buffer + i * 2) += delta * *(const band_limited_vector_t *)(steps + i * 2);
+    }
+    if (i < taps) {
+        buffer[i * 2] += delta[0] * steps[i * 2];
+        buffer[i * 2 + 1] += delta[1] * steps[i * 2 + 1];
+    }
+}
+
+static void band_limited_update(GB_band_limited_t *band_limited, const GB_sample_t *input, unsigned phase,
+                                const int32_t *steps, unsigned width)
 {
     if (input->packed == band_limited->input.packed) return;
     unsigned delay = phase / GB_BAND_LIMITED_PHASES;
@@ -69,11 +101,14 @@ static void band_limited_update(GB_band_limited_t *band_limited, const GB_sample
     };
     band_limited->input.packed = input->packed;
     
-    for (unsigned i = 0; i < GB_BAND_LIMITED_WIDTH; i++) {
-        unsigned offset = (i + band_limited->pos + delay) & (sizeof(band_limited->buffer) / sizeof(band_limited->buffer[0]) - 1);
-        band_limited->buffer[offset].left += delta.left * band_limited_steps[phase][i];
-        band_limited->buffer[offset].right += delta.right * band_limited_steps[phase][i];
-    }
+    /* The steps are added in at most two contiguous runs, so the ring buffer doesn't wrap around mid-run */
+    const unsigned length = sizeof(band_limited->buffer) / sizeof(band_limited->buffer[0]);
+    unsigned start = (band_limited->pos + delay) & (length - 1);
+    unsigned first_run = MIN(length - start, width);
+    band_limited_vector_t delta_vector = {delta.left, delta.right, delta.left, delta.right};
+    steps += phase * width * 2;
+    band_limited_add_steps(&band_limited->buffer[start].left, steps, first_run, delta_vector);
+    band_limited_add_steps(&band_limited->buffer[0].left, steps + first_run * 2, width - first_run, delta_vector);
 }
 
 static void band_limited_update_unfiltered(GB_band_limited_t *band_limited, const GB_sample_t *input, unsigned delay)
@@ -138,6 +173,22 @@ static inline uint32_t sample_fraction_multiply(GB_gameboy_t *gb, unsigned multi
     return gb->apu_output.quick_fraction_multiply_cache[0] * multiplier;
 }
 
+static void update_channel_output(GB_gameboy_t *gb, unsigned index, const GB_sample_t *output, unsigned cycles_offset)
+{
+    GB_band_limited_t *band_limited = &gb->apu_output.band_limited[index];
+    if (unlikely(gb->apu_output.max_cycles_per_sample == 1)) {
+        band_limited_update_unfiltered(band_limited, output, cycles_offset);
+        return;
+    }
+    
+    unsigned phase = (((gb->apu_output.sample_fraction + sample_fraction_multiply(gb, cycles_offset)) >> 8) * GB_BAND_LIMITED_PHASES) >> 20;
+    if (unlikely(gb->apu_output.quality == GB_AUDIO_QUALITY_LOW)) {
+        band_limited_update_unfiltered(band_limited, output, phase / GB_BAND_LIMITED_PHASES);
+        return;
+    }
+    band_limited_update(band_limited, output, phase, gb->apu_output.band_limited_steps, gb->apu_output.band_limited_width);
+}
+
 static const uint8_t duties[] = {
     0, 0, 0, 0, 0, 0, 0, 1,
     1, 0, 0, 0, 0, 0, 0, 1,
@@ -223,14 +274,7 @@ static void update_sample(GB_gameboy_t *gb, GB_channel_t index, int8_t value, un
                 output.left = output.right = 0;
             }
             
-            if (unlikely(gb->apu_output.max_cycles_per_sample == 1)) {
-                band_limited_update_unfiltered(&gb->apu_output.band_limited[index], &output, cycles_offset);
-            }
-            else {
-                band_limited_update(&gb->apu_output.band_limited[index],
-                                    &output,
-                                    (((gb->apu_output.sample_fraction + sample_fraction_multiply(gb, cycles_offset)) >> 8) * GB_BAND_LIMITED_PHASES) >> 20);
-            }
+            update_channel_output(gb, index, &output, cycles_offset);
         }
         
         return;
@@ -258,20 +302,50 @@ static void update_sample(GB_gameboy_t *gb, GB_channel_t index, int8_t value, un
         if (likely(!gb->apu_output.channel_muted[index])) {
             output = (GB_sample_t){(0xF - value * 2) * left_volume, (0xF - value * 2) * right_volume};
         }
-        if (unlikely(gb->apu_output.max_cycles_per_sample == 1)) {
-            band_limited_update_unfiltered(&gb->apu_output.band_limited[index], &output, cycles_offset);
-        }
-        else {
-            band_limited_update(&gb->apu_output.band_limited[index],
-                                &output,
-                                (((gb->apu_output.sample_fraction + sample_fraction_multiply(gb, cycles_offset)) >> 8) * GB_BAND_LIMITED_PHASES) >> 20);
-        }
+        update_channel_output(gb, index, &output, cycles_offset);
     }
 }
 
-static double smooth(double x)
+/* Calls update_sample with the current values so the APU output is updated with the new outputs */
+static void update_all_samples(GB_gameboy_t *gb)
 {
-    return 3*x*x - 2*x*x*x;
+    for (unsigned i = GB_N_CHANNELS; i--;) {
+        int8_t sample = gb->apu.samples[i];
+        gb->apu.samples[i] = 0x10; // Invalidate to force update
+        update_sample(gb, i, sample, 0);
+    }
+}
+
+/* CH_STEP scaled by a smoothstep of the DAC's charge, indexed by the 16.16 charge >> 8 */
+static uint8_t dac_multipliers[0x101];
+
+static void __attribute__((constructor)) dac_multipliers_init(void)
+{
+    for (unsigned i = 0; i <= 0x100; i++) {
+        double x = i / 256.0;
+        dac_multipliers[i] = CH_STEP * (3 * x * x - 2 * x * x * x);
+    }
+}
+
+/* Moves a 16.16 fixed point filter state towards target by highpass_weight */
+static inline int32_t highpass_step(GB_gameboy_t *gb, int32_t state, signed target)
+{
+    return state + ((((int64_t)target << 16) - state) * gb->apu_output.highpass_weight >> 30);
+}
+
+/* The DC offset a channel contributes in GB_HIGHPASS_REMOVE_DC_OFFSET mode, using the same panning and volume
+   mapping as update_sample. Shared by the mix and the stems so they add up. */
+static GB_sample_t dc_offset(GB_gameboy_t *gb, unsigned index)
+{
+    GB_sample_t ret = {0, 0};
+    if (!GB_apu_is_DAC_enabled(gb, index)) return ret;
+    if (gb->io_registers[GB_IO_NR51] & (0x10 << index)) {
+        ret.left = (((gb->io_registers[GB_IO_NR50] >> 4) & 7) + 1) * CH_STEP * 0xF;
+    }
+    if (gb->io_registers[GB_IO_NR51] & (1 << index)) {
+        ret.right = ((gb->io_registers[GB_IO_NR50] & 7) + 1) * CH_STEP * 0xF;
+    }
+    return ret;
 }
 
 static signed interference(GB_gameboy_t *gb)
@@ -313,31 +387,216 @@ static signed interference(GB_gameboy_t *gb)
     return ret;
 }
 
+void GB_apu_output_sample(GB_gameboy_t *gb, GB_sample_t *sample)
+{
+    if (gb->apu_output.sample_buffer) {
+        gb->apu_output.sample_buffer[gb->apu_output.sample_buffer_position++] = *sample;
+        if (unlikely(gb->apu_output.sample_buffer_position == gb->apu_output.sample_buffer_size)) {
+            GB_apu_flush_sample_buffer(gb);
+        }
+        return;
+    }
+    assert(gb->apu_output.sample_callback);
+    gb->apu_output.sample_callback(gb, sample);
+}
+
+/* Audio recordings are collected in memory and written in large blocks by a writer thread, so disk stalls and
+   per-sample stdio overhead don't affect emulation. Without threads, blocks are written synchronously. */
+#define RECORDING_BUFFER_SIZE 0x10000 // In samples, per buffer
+
+struct GB_audio_recorder_s {
+    FILE *file;
+    GB_sample_t buffers[2][RECORDING_BUFFER_SIZE];
+    unsigned current; // The buffer being filled by the emulation thread
+    size_t position;
+    int error;
+#ifndef GB_DISABLE_THREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t pending; // Samples in the other buffer waiting to be written
+    bool stopping;
+#endif
+};
+
+#ifndef GB_DISABLE_THREADS
+static void *recorder_thread(void *context)
+{
+    GB_audio_recorder_t *recorder = context;
+    pthread_mutex_lock(&recorder->lock);
+    while (true) {
+        while (!recorder->pending && !recorder->stopping) {
+            pthread_cond_wait(&recorder->cond, &recorder->lock);
+        }
+        if (!recorder->pending) break;
+        
+        size_t count = recorder->pending;
+        const GB_sample_t *buffer = recorder->buffers[!recorder->current];
+        bool failed = recorder->error;
+        pthread_mutex_unlock(&recorder->lock);
+        int error = 0;
+        if (!failed && fwrite(buffer, sizeof(*buffer), count, recorder->file) != count) {
+            error = errno ?: EIO;
+        }
+        pthread_mutex_lock(&recorder->lock);
+        if (error) {
+            recorder->error = error;
+        }
+        recorder->pending = 0;
+        pthread_cond_signal(&recorder->cond);
+    }
+    pthread_mutex_unlock(&recorder->lock);
+    return NULL;
+}
+#endif
+
+static GB_audio_recorder_t *recorder_create(FILE *file)
+{
+    GB_audio_recorder_t *recorder = malloc(sizeof(*recorder));
+    if (!recorder) return NULL;
+    recorder->file = file;
+    recorder->current = 0;
+    recorder->position = 0;
+    recorder->error = 0;
+#ifndef GB_DISABLE_THREADS
+    recorder->pending = 0;
+    recorder->stopping = false;
+    pthread_mutex_init(&recorder->lock, NULL);
+    pthread_cond_init(&recorder->cond, NULL);
+    if (pthread_create(&recorder->thread, NULL, recorder_thread, recorder)) {
+        pthread_mutex_destroy(&recorder->lock);
+        pthread_cond_destroy(&recorder->cond);
+        free(recorder);
+        return NULL;
+    }
+#endif
+    return recorder;
+}
+
+/* Hands the current buffer over to be written, returns the first write error, if any */
+static int recorder_submit(GB_audio_recorder_t *recorder)
+{
+#ifndef GB_DISABLE_THREADS
+    pthread_mutex_lock(&recorder->lock);
+    /* Only blocks if the disk can't keep up with the sample rate for a whole buffer */
+    while (recorder->pending) {
+        pthread_cond_wait(&recorder->cond, &recorder->lock);
+    }
+    recorder->pending = recorder->position;
+    recorder->current ^= 1;
+    int error = recorder->error;
+    pthread_cond_signal(&recorder->cond);
+    pthread_mutex_unlock(&recorder->lock);
+#else
+    if (!recorder->error &&
+        fwrite(recorder->buffers[0], sizeof(GB_sample_t), recorder->position, recorder->file) != recorder->position) {
+        recorder->error = errno ?: EIO;
+    }
+    int error = recorder->error;
+#endif
+    recorder->position = 0;
+    return error;
+}
+
+/* Writes everything that was recorded and frees the recorder, returning its file */
+static FILE *recorder_finish(GB_audio_recorder_t *recorder, int *error)
+{
+    if (recorder->position) {
+        recorder_submit(recorder);
+    }
+#ifndef GB_DISABLE_THREADS
+    pthread_mutex_lock(&recorder->lock);
+    recorder->stopping = true;
+    pthread_cond_signal(&recorder->cond);
+    pthread_mutex_unlock(&recorder->lock);
+    pthread_join(recorder->thread, NULL);
+    pthread_mutex_destroy(&recorder->lock);
+    pthread_cond_destroy(&recorder->cond);
+#endif
+    FILE *file = recorder->file;
+    *error = recorder->error;
+    free(recorder);
+    return file;
+}
+
+/* count must be the same for the entire recording, and divide RECORDING_BUFFER_SIZE */
+static void record_samples(GB_gameboy_t *gb, const GB_sample_t *samples, unsigned count)
+{
+    GB_audio_recorder_t *recorder = gb->apu_output.recorder;
+    GB_sample_t *dest = recorder->buffers[recorder->current] + recorder->position;
+    for (unsigned i = 0; i < count; i++) {
+        dest[i] = samples[i];
+#ifdef GB_BIG_ENDIAN
+        if (gb->apu_output.output_format == GB_AUDIO_FORMAT_WAV) {
+            dest[i].left = LE16(dest[i].left);
+            dest[i].right = LE16(dest[i].right);
+        }
+#endif
+    }
+    recorder->position += count;
+    if (unlikely(recorder->position == RECORDING_BUFFER_SIZE) && recorder_submit(recorder)) {
+        int error;
+        fclose(recorder_finish(recorder, &error));
+        gb->apu_output.recorder = NULL;
+        gb->apu_output.output_error = error;
+    }
+}
+
+/* Stems get the same highpass filter as the mix, applied to each channel separately */
+static void record_stems(GB_gameboy_t *gb, GB_sample_t *stems)
+{
+    unrolled for (unsigned i = 0; i < GB_N_CHANNELS; i++) {
+        GB_fixed_sample_t *diff = &gb->apu_output.stem_highpass_diff[i];
+        GB_sample_t target = stems[i];
+        switch (gb->apu_output.highpass_mode) {
+            case GB_HIGHPASS_OFF:
+            case GB_HIGHPASS_MAX:
+                continue;
+            case GB_HIGHPASS_ACCURATE:
+                break;
+            case GB_HIGHPASS_REMOVE_DC_OFFSET:
+                target = dc_offset(gb, i);
+                break;
+        }
+        GB_sample_t filtered = {
+            stems[i].left - (int16_t)(diff->left >> 16),
+            stems[i].right - (int16_t)(diff->right >> 16),
+        };
+        *diff = (GB_fixed_sample_t) {
+            highpass_step(gb, diff->left, target.left),
+            highpass_step(gb, diff->right, target.right),
+        };
+        stems[i] = filtered;
+    }
+    record_samples(gb, stems, GB_N_CHANNELS);
+}
+
 static void render(GB_gameboy_t *gb)
 {
     GB_sample_t output = {0, 0};
+    GB_sample_t stems[GB_N_CHANNELS];
 
     unrolled for (unsigned i = 0; i < GB_N_CHANNELS; i++) {
-        double multiplier = CH_STEP;
+        unsigned multiplier = CH_STEP;
         
         if (gb->model <= GB_MODEL_CGB_E) {
             if (!GB_apu_is_DAC_enabled(gb, i)) {
-                gb->apu_output.dac_discharge[i] -= ((double) DAC_DECAY_SPEED) / gb->apu_output.sample_rate;
+                gb->apu_output.dac_discharge[i] -= gb->apu_output.dac_decay_step;
                 if (gb->apu_output.dac_discharge[i] < 0) {
                     multiplier = 0;
                     gb->apu_output.dac_discharge[i] = 0;
                 }
                 else {
-                    multiplier *= smooth(gb->apu_output.dac_discharge[i]);
+                    multiplier = dac_multipliers[gb->apu_output.dac_discharge[i] >> 8];
                 }
             }
             else {
-                gb->apu_output.dac_discharge[i] += ((double) DAC_ATTACK_SPEED) / gb->apu_output.sample_rate;
-                if (gb->apu_output.dac_discharge[i] > 1) {
-                    gb->apu_output.dac_discharge[i] = 1;
+                gb->apu_output.dac_discharge[i] += gb->apu_output.dac_attack_step;
+                if (gb->apu_output.dac_discharge[i] > 0x10000) {
+                    gb->apu_output.dac_discharge[i] = 0x10000;
                 }
                 else {
-                    multiplier *= smooth(gb->apu_output.dac_discharge[i]);
+                    multiplier = dac_multipliers[gb->apu_output.dac_discharge[i] >> 8];
                 }
             }
         }
@@ -347,6 +606,7 @@ static void render(GB_gameboy_t *gb)
 
         output.left += channel_output.left;
         output.right += channel_output.right;
+        stems[i] = channel_output;
     }
     gb->apu_output.cycles_since_render = 0;
     if (unlikely(gb->apu_output.sample_fraction < (1 << 28))) {
@@ -357,40 +617,37 @@ static void render(GB_gameboy_t *gb)
     }
     
     if (gb->sgb && gb->sgb->intro_animation < GB_SGB_INTRO_ANIMATION_LENGTH) return;
+    
+    if (unlikely(gb->apu_output.recorder && gb->apu_output.recording_stems)) {
+        record_stems(gb, stems);
+    }
 
     GB_sample_t filtered_output = gb->apu_output.highpass_mode?
-        (GB_sample_t) {output.left  - (int16_t)gb->apu_output.highpass_diff.left,
-                       output.right - (int16_t)gb->apu_output.highpass_diff.right} :
+        (GB_sample_t) {output.left  - (int16_t)(gb->apu_output.highpass_diff.left >> 16),
+                       output.right - (int16_t)(gb->apu_output.highpass_diff.right >> 16)} :
         output;
 
     switch (gb->apu_output.highpass_mode) {
         case GB_HIGHPASS_OFF:
-            gb->apu_output.highpass_diff = (GB_double_sample_t) {0, 0};
+            gb->apu_output.highpass_diff = (GB_fixed_sample_t) {0, 0};
             break;
         case GB_HIGHPASS_ACCURATE:
-            gb->apu_output.highpass_diff = (GB_double_sample_t) {
-                output.left  - (output.left  - gb->apu_output.highpass_diff.left)  * gb->apu_output.highpass_rate,
-                output.right - (output.right - gb->apu_output.highpass_diff.right) * gb->apu_output.highpass_rate
+            gb->apu_output.highpass_diff = (GB_fixed_sample_t) {
+                highpass_step(gb, gb->apu_output.highpass_diff.left, output.left),
+                highpass_step(gb, gb->apu_output.highpass_diff.right, output.right),
             };
             break;
         case GB_HIGHPASS_REMOVE_DC_OFFSET: {
-            unsigned mask = gb->io_registers[GB_IO_NR51];
-            unsigned left_volume = 0;
-            unsigned right_volume = 0;
-            unrolled for (unsigned i = GB_N_CHANNELS; i--;) {
-                if (GB_apu_is_DAC_enabled(gb, i)) {
-                    if (mask & 1) {
-                        left_volume += ((gb->io_registers[GB_IO_NR50] & 7) + 1) * CH_STEP * 0xF;
-                    }
-                    if (mask & 0x10) {
-                        right_volume += (((gb->io_registers[GB_IO_NR50] >> 4) & 7) + 1) * CH_STEP * 0xF;
-                    }
-                }
-                mask >>= 1;
-            }
-            gb->apu_output.highpass_diff = (GB_double_sample_t) {
-                left_volume  * (1 - gb->apu_output.highpass_rate) + gb->apu_output.highpass_diff.left * gb->apu_output.highpass_rate,
-                right_volume * (1 - gb->apu_output.highpass_rate) + gb->apu_output.highpass_diff.right * gb->apu_output.highpass_rate
+            signed left_volume = 0;
+            signed right_volume = 0;
+            unrolled for (unsigned i = 0; i < GB_N_CHANNELS; i++) {
+                GB_sample_t offset = dc_offset(gb, i);
+                left_volume += offset.left;
+                right_volume += offset.right;
+            }
+            gb->apu_output.highpass_diff = (GB_fixed_sample_t) {
+                highpass_step(gb, gb->apu_output.highpass_diff.left, left_volume),
+                highpass_step(gb, gb->apu_output.highpass_diff.right, right_volume),
             };
 
         case GB_HIGHPASS_MAX:;
@@ -401,28 +658,16 @@ static void render(GB_gameboy_t *gb)
     
     if (gb->apu_output.interference_volume) {
         signed interference_bias = interference(gb);
-        int16_t interference_sample = (interference_bias - gb->apu_output.interference_highpass);
-        gb->apu_output.interference_highpass = gb->apu_output.interference_highpass * gb->apu_output.highpass_rate +
-        (1 - gb->apu_output.highpass_rate) * interference_sample;
-        interference_bias *= gb->apu_output.interference_volume;
+        int16_t interference_sample = (interference_bias - (gb->apu_output.interference_highpass >> 16));
+        gb->apu_output.interference_highpass = highpass_step(gb, gb->apu_output.interference_highpass, interference_sample);
+        interference_bias = interference_bias * gb->apu_output.interference_volume >> 16;
         
         filtered_output.left = MAX(MIN(filtered_output.left + interference_bias, 0x7FFF), -0x8000);
         filtered_output.right = MAX(MIN(filtered_output.right + interference_bias, 0x7FFF), -0x8000);
     }
-    assert(gb->apu_output.sample_callback);
-    gb->apu_output.sample_callback(gb, &filtered_output);
-    if (unlikely(gb->apu_output.output_file)) {
-#ifdef GB_BIG_ENDIAN
-        if (gb->apu_output.output_format == GB_AUDIO_FORMAT_WAV) {
-            filtered_output.left = LE16(filtered_output.left);
-            filtered_output.right = LE16(filtered_output.right);
-        }
-#endif
-        if (fwrite(&filtered_output, sizeof(filtered_output), 1, gb->apu_output.output_file) != 1) {
-            fclose(gb->apu_output.output_file);
-            gb->apu_output.output_file = NULL;
-            gb->apu_output.output_error = errno;
-        }
+    GB_apu_output_sample(gb, &filtered_output);
+    if (unlikely(gb->apu_output.recorder && !gb->apu_output.recording_stems)) {
+        record_samples(gb, &filtered_output, 1);
     }
 }
 
@@ -1682,6 +1927,9 @@ static void nr43_write(GB_gameboy_t *gb, uint8_t new)
 void GB_apu_write(GB_gameboy_t *gb, uint8_t reg, uint8_t value)
 {
     GB_apu_run(gb, true);
+    if (unlikely(gb->vgm_logger)) {
+        GB_vgm_log_write(gb, reg, value);
+    }
     if (!gb->apu.global_enable && reg != GB_IO_NR52 && reg < GB_IO_WAV_START && (GB_is_cgb(gb) ||
                                                                                 (
                                                                                 reg != GB_IO_NR11 &&
@@ -1707,12 +1955,7 @@ void GB_apu_write(GB_gameboy_t *gb, uint8_t reg, uint8_t value)
         case GB_IO_NR51:
             gb->io_registers[reg] = value;
             /* These registers affect the output of all 4 channels (but not the output of the PCM registers).*/
-            /* We call update_samples with the current value so the APU output is updated with the new outputs */
-            for (unsigned i = GB_N_CHANNELS; i--;) {
-                int8_t sample = gb->apu.samples[i];
-                gb->apu.samples[i] = 0x10; // Invalidate to force update
-                update_sample(gb, i, sample, 0);
-            }
+            update_all_samples(gb);
             break;
         case GB_IO_NR52: {
 
@@ -2161,6 +2404,43 @@ void GB_apu_write(GB_gameboy_t *gb, uint8_t reg, uint8_t value)
     gb->io_registers[reg] = value;
 }
 
+static void update_band_limited_kernel(GB_gameboy_t *gb)
+{
+    switch (gb->apu_output.quality) {
+        case GB_AUDIO_QUALITY_HIGH:
+            gb->apu_output.band_limited_width = GB_BAND_LIMITED_WIDTH;
+            break;
+        case GB_AUDIO_QUALITY_MEDIUM:
+            gb->apu_output.band_limited_width = 16;
+            break;
+        case GB_AUDIO_QUALITY_LOW:
+            gb->apu_output.band_limited_width = 0;
+            gb->apu_output.band_limited_steps = NULL;
+            return;
+    }
+    gb->apu_output.band_limited_steps = band_limited_steps(gb->apu_output.band_limited_width);
+}
+
+static void update_output_coefficients(GB_gameboy_t *gb, double highpass_rate)
+{
+    if (!gb->apu_output.band_limited_steps) {
+        update_band_limited_kernel(gb);
+    }
+    gb->apu_output.highpass_weight = round((1 - highpass_rate) * (1 << 30));
+    gb->apu_output.dac_decay_step = MAX(DAC_DECAY_SPEED * 0x10000LL / gb->apu_output.sample_rate, 1);
+    gb->apu_output.dac_attack_step = MAX(DAC_ATTACK_SPEED * 0x10000LL / gb->apu_output.sample_rate, 1);
+}
+
+/* Moves the configured rate aside while audio is disabled, so no samples are generated */
+static void stash_sample_rate(GB_gameboy_t *gb)
+{
+    if (!gb->apu_output.disabled) return;
+    gb->apu_output.enabled_sample_rate = gb->apu_output.sample_rate;
+    gb->apu_output.enabled_max_cycles_per_sample = gb->apu_output.max_cycles_per_sample;
+    gb->apu_output.sample_rate = 0;
+    gb->apu_output.max_cycles_per_sample = 0x400;
+}
+
 void GB_set_sample_rate(GB_gameboy_t *gb, unsigned sample_rate)
 {
     if (gb->apu_output.sample_rate != sample_rate) {
@@ -2168,7 +2448,7 @@ void GB_set_sample_rate(GB_gameboy_t *gb, unsigned sample_rate)
     }
     gb->apu_output.sample_rate = sample_rate;
     if (sample_rate) {
-        gb->apu_output.highpass_rate = pow(0.999958, GB_get_clock_rate(gb) / (double)sample_rate);
+        update_output_coefficients(gb, pow(0.999958, GB_get_clock_rate(gb) / (double)sample_rate));
         gb->apu_output.max_cycles_per_sample = ceil(GB_get_clock_rate(gb) / 2.0 / sample_rate);
         gb->apu_output.quick_fraction_multiply_cache[0] = round(sample_rate * 2.0 / GB_get_clock_rate(gb) * (1 << 28));
         for (unsigned i = 1; i < GB_QUICK_MULTIPLY_COUNT; i++) {
@@ -2178,6 +2458,7 @@ void GB_set_sample_rate(GB_gameboy_t *gb, unsigned sample_rate)
     else {
         gb->apu_output.max_cycles_per_sample = 0x400;
     }
+    stash_sample_rate(gb);
 }
 
 void GB_set_sample_rate_by_clocks(GB_gameboy_t *gb, double cycles_per_sample)
@@ -2188,25 +2469,79 @@ void GB_set_sample_rate_by_clocks(GB_gameboy_t *gb, double cycles_per_sample)
         return;
     }
     gb->apu_output.sample_rate = GB_get_clock_rate(gb) / cycles_per_sample * 2;
-    gb->apu_output.highpass_rate = pow(0.999958, cycles_per_sample);
+    update_output_coefficients(gb, pow(0.999958, cycles_per_sample));
     gb->apu_output.max_cycles_per_sample = ceil(cycles_per_sample / 4);
     
     gb->apu_output.quick_fraction_multiply_cache[0] = round(gb->apu_output.sample_rate * 2.0 / GB_get_clock_rate(gb) * (1 << 28));
     for (unsigned i = 1; i < GB_QUICK_MULTIPLY_COUNT; i++) {
         gb->apu_output.quick_fraction_multiply_cache[i] = gb->apu_output.quick_fraction_multiply_cache[0] * (i + 1);
     }
+    stash_sample_rate(gb);
 }
 
 unsigned GB_get_sample_rate(GB_gameboy_t *gb)
 {
+    if (gb->apu_output.disabled) {
+        return gb->apu_output.enabled_sample_rate;
+    }
     return gb->apu_output.sample_rate;
 }
 
+void GB_set_audio_disabled(GB_gameboy_t *gb, bool disabled)
+{
+    GB_ASSERT_NOT_RUNNING_OTHER_THREAD(gb)
+    if (gb->apu_output.disabled == disabled) return;
+    if (!disabled) {
+        gb->apu_output.disabled = false;
+        gb->apu_output.sample_rate = gb->apu_output.enabled_sample_rate;
+        gb->apu_output.max_cycles_per_sample = gb->apu_output.enabled_max_cycles_per_sample;
+        gb->apu_output.sample_cycles = 0;
+        gb->apu_output.cycles_since_render = 0;
+        /* The channel outputs weren't tracked while disabled */
+        if (gb->apu_output.sample_rate) {
+            update_all_samples(gb);
+        }
+        return;
+    }
+    if (gb->apu_output.recorder) {
+        GB_stop_audio_recording(gb);
+    }
+    gb->apu_output.disabled = true;
+    stash_sample_rate(gb);
+}
+
+bool GB_is_audio_disabled(GB_gameboy_t *gb)
+{
+    return gb->apu_output.disabled;
+}
+
 void GB_apu_set_sample_callback(GB_gameboy_t *gb, GB_sample_callback_t callback)
 {
     gb->apu_output.sample_callback = callback;
 }
 
+void GB_apu_set_sample_buffer(GB_gameboy_t *gb, GB_sample_t *buffer, size_t size, GB_sample_buffer_callback_t callback)
+{
+    GB_apu_flush_sample_buffer(gb);
+    if (!buffer || !size || !callback) {
+        buffer = NULL;
+        size = 0;
+        callback = NULL;
+    }
+    gb->apu_output.sample_buffer = buffer;
+    gb->apu_output.sample_buffer_size = size;
+    gb->apu_output.sample_buffer_callback = callback;
+}
+
+size_t GB_apu_flush_sample_buffer(GB_gameboy_t *gb)
+{
+    size_t count = gb->apu_output.sample_buffer_position;
+    if (!count) return 0;
+    gb->apu_output.sample_buffer_position = 0;
+    gb->apu_output.sample_buffer_callback(gb, gb->apu_output.sample_buffer, count);
+    return count;
+}
+
 void GB_set_highpass_filter_mode(GB_gameboy_t *gb, GB_highpass_mode_t mode)
 {
     gb->apu_output.highpass_mode = mode;
@@ -2214,7 +2549,20 @@ void GB_set_highpass_filter_mode(GB_gameboy_t *gb, GB_highpass_mode_t mode)
 
 void GB_set_interference_volume(GB_gameboy_t *gb, double volume)
 {
-    gb->apu_output.interference_volume = volume;
+    gb->apu_output.interference_volume = round(volume * 0x10000);
+}
+
+void GB_set_audio_quality(GB_gameboy_t *gb, GB_audio_quality_t quality)
+{
+    if (quality > GB_AUDIO_QUALITY_LOW) return;
+    GB_ASSERT_NOT_RUNNING_OTHER_THREAD(gb)
+    gb->apu_output.quality = quality;
+    update_band_limited_kernel(gb);
+}
+
+GB_audio_quality_t GB_get_audio_quality(GB_gameboy_t *gb)
+{
+    return gb->apu_output.quality;
 }
 
 typedef struct __attribute__((packed)) {
@@ -2253,8 +2601,8 @@ typedef struct __attribute__((packed)) {
     uint16_t format; // = LE16(1)
     uint16_t channels; // = LE16(2)
     uint32_t sample_rate; // = LE32(sample_rate)
-    uint32_t byte_rate; // = LE32(sample_rate * 4)
-    uint16_t frame_size;  // = LE32(4)
+    uint32_t byte_rate; // = LE32(sample_rate * frame_size)
+    uint16_t frame_size;  // = LE16(channels * 2)
     uint16_t bit_depth; // = LE16(16)
     
     uint32_t data_chunk; // = BE32('data')
@@ -2262,62 +2610,90 @@ typedef struct __attribute__((packed)) {
 } wav_header_t;
 
 
-int GB_start_audio_recording(GB_gameboy_t *gb, const char *path, GB_audio_format_t format)
+static int start_audio_recording(GB_gameboy_t *gb, const char *path, GB_audio_format_t format, bool stems)
 {
     if (gb->apu_output.sample_rate == 0) {
         return EINVAL;
     }
     
-    if (gb->apu_output.output_file) {
+    if (gb->apu_output.recorder) {
         GB_stop_audio_recording(gb);
     }
-    gb->apu_output.output_file = fopen(path, "wb");
-    if (!gb->apu_output.output_file) return errno;
     
-    gb->apu_output.output_format = format;
+    size_t header_size;
     switch (format) {
         case GB_AUDIO_FORMAT_RAW:
-            return 0;
-        case GB_AUDIO_FORMAT_AIFF: {
-            aiff_header_t header = {0,};
-            if (fwrite(&header, sizeof(header), 1, gb->apu_output.output_file) != 1) {
-                int ret = errno ?: EIO;
-                fclose(gb->apu_output.output_file);
-                gb->apu_output.output_file = NULL;
-                return ret;
-            }
-            return 0;
-        }
-        case GB_AUDIO_FORMAT_WAV: {
-            wav_header_t header = {0,};
-            if (fwrite(&header, sizeof(header), 1, gb->apu_output.output_file) != 1) {
-                int ret = errno ?: EIO;
-                fclose(gb->apu_output.output_file);
-                gb->apu_output.output_file = NULL;
-                return ret;
-            }
-            return 0;
-        }
+            header_size = 0;
+            break;
+        case GB_AUDIO_FORMAT_AIFF:
+            header_size = sizeof(aiff_header_t);
+            break;
+        case GB_AUDIO_FORMAT_WAV:
+            header_size = sizeof(wav_header_t);
+            break;
         default:
-            fclose(gb->apu_output.output_file);
-            gb->apu_output.output_file = NULL;
             return EINVAL;
     }
+    
+    FILE *file = fopen(path, "wb");
+    if (!file) return errno;
+    
+    if (header_size) {
+        /* Placeholder, the header is written by GB_stop_audio_recording */
+        union {
+            aiff_header_t aiff;
+            wav_header_t wav;
+        } header = {{0,}};
+        if (fwrite(&header, header_size, 1, file) != 1) {
+            int ret = errno ?: EIO;
+            fclose(file);
+            return ret;
+        }
+    }
+    
+    gb->apu_output.recorder = recorder_create(file);
+    if (!gb->apu_output.recorder) {
+        fclose(file);
+        return ENOMEM;
+    }
+    gb->apu_output.output_format = format;
+    gb->apu_output.recording_stems = stems;
+    memset(gb->apu_output.stem_highpass_diff, 0, sizeof(gb->apu_output.stem_highpass_diff));
+    return 0;
+}
+
+int GB_start_audio_recording(GB_gameboy_t *gb, const char *path, GB_audio_format_t format)
+{
+    return start_audio_recording(gb, path, format, false);
+}
+
+int GB_start_audio_stem_recording(GB_gameboy_t *gb, const char *path, GB_audio_format_t format)
+{
+    return start_audio_recording(gb, path, format, true);
 }
 int GB_stop_audio_recording(GB_gameboy_t *gb)
 {
-    if (!gb->apu_output.output_file) {
+    if (!gb->apu_output.recorder) {
         int ret  = gb->apu_output.output_error ?: -1;
         gb->apu_output.output_error = 0;
         return ret;
     }
+    int error;
+    FILE *file = recorder_finish(gb->apu_output.recorder, &error);
+    gb->apu_output.recorder = NULL;
     gb->apu_output.output_error = 0;
+    if (error) {
+        fclose(file);
+        return error;
+    }
+    unsigned channels = gb->apu_output.recording_stems? GB_N_CHANNELS * 2 : 2;
+    size_t frame_size = channels * sizeof(int16_t);
     switch (gb->apu_output.output_format) {
         case GB_AUDIO_FORMAT_RAW:
             break;
         case GB_AUDIO_FORMAT_AIFF: {
-            size_t file_size = ftell(gb->apu_output.output_file);
-            size_t frames = (file_size - sizeof(aiff_header_t)) / sizeof(GB_sample_t);
+            size_t file_size = ftell(file);
+            size_t frames = (file_size - sizeof(aiff_header_t)) / frame_size;
             aiff_header_t header = {
                 .format_chunk = BE32('FORM'),
                 .size = BE32(file_size - 8),
@@ -2329,7 +2705,7 @@ int GB_stop_audio_recording(GB_gameboy_t *gb)
                 
                 .comm_chunk = BE32('COMM'),
                 .comm_size = BE32(0x18),
-                .channels = BE16(2),
+                .channels = BE16(channels),
                 .samples_per_channel = BE32(frames),
                 .bit_depth = BE16(16),
 #ifdef GB_BIG_ENDIAN
@@ -2339,7 +2715,7 @@ int GB_stop_audio_recording(GB_gameboy_t *gb)
 #endif
                 .compression_name = 0,
                 .ssnd_chunk = BE32('SSND'),
-                .ssnd_size = BE32(frames * sizeof(GB_sample_t) - 8),
+                .ssnd_size = BE32(frames * frame_size - 8),
                 .ssnd_offset = 0,
                 .ssnd_block = 0,
             };
@@ -2353,15 +2729,15 @@ int GB_stop_audio_recording(GB_gameboy_t *gb)
             header.frequency_exponent = BE16(exponent);
             header.frequency_significand = BE64(significand);
             
-            fseek(gb->apu_output.output_file, 0, SEEK_SET);
-            if (fwrite(&header, sizeof(header), 1, gb->apu_output.output_file) != 1) {
+            fseek(file, 0, SEEK_SET);
+            if (fwrite(&header, sizeof(header), 1, file) != 1) {
                 gb->apu_output.output_error = errno;
             }
             break;
         }
         case GB_AUDIO_FORMAT_WAV: {
-            size_t file_size = ftell(gb->apu_output.output_file);
-            size_t frames = (file_size - sizeof(wav_header_t)) / sizeof(GB_sample_t);
+            size_t file_size = ftell(file);
+            size_t frames = (file_size - sizeof(wav_header_t)) / frame_size;
             wav_header_t header = {
                 .marker = BE32('RIFF'),
                 .size = LE32(file_size - 8),
@@ -2370,25 +2746,24 @@ int GB_stop_audio_recording(GB_gameboy_t *gb)
                 .fmt_chunk = BE32('fmt '),
                 .fmt_size = LE16(16),
                 .format = LE16(1),
-                .channels = LE16(2),
+                .channels = LE16(channels),
                 .sample_rate = LE32(gb->apu_output.sample_rate),
-                .byte_rate = LE32(gb->apu_output.sample_rate * 4),
-                .frame_size = LE32(4),
+                .byte_rate = LE32(gb->apu_output.sample_rate * frame_size),
+                .frame_size = LE16(frame_size),
                 .bit_depth = LE16(16),
                 
                 .data_chunk = BE32('data'),
-                .data_size = LE32(frames * sizeof(GB_sample_t)),
+                .data_size = LE32(frames * frame_size),
             };
             
-            fseek(gb->apu_output.output_file, 0, SEEK_SET);
-            if (fwrite(&header, sizeof(header), 1, gb->apu_output.output_file) != 1) {
+            fseek(file, 0, SEEK_SET);
+            if (fwrite(&header, sizeof(header), 1, file) != 1) {
                 gb->apu_output.output_error = errno;
             }
             break;
         }
     }
-    fclose(gb->apu_output.output_file);
-    gb->apu_output.output_file = NULL;
+    fclose(file);
     
     int ret  = gb->apu_output.output_error;
     gb->apu_output.output_error = 0;
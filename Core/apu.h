@@ -50,6 +50,12 @@ typedef struct
     double right;
 } GB_double_sample_t;
 
+typedef struct
+{
+    int32_t left;
+    int32_t right;
+} GB_fixed_sample_t; // 16.16 fixed point
+
 typedef enum {
     GB_SQUARE_1,
     GB_SQUARE_2,
@@ -67,6 +73,8 @@ typedef struct
 } GB_envelope_clock_t;
 
 typedef void (*GB_sample_callback_t)(GB_gameboy_t *gb, GB_sample_t *sample);
+typedef void (*GB_sample_buffer_callback_t)(GB_gameboy_t *gb, GB_sample_t *samples, size_t count);
+typedef struct GB_audio_recorder_s GB_audio_recorder_t;
 
 typedef struct
 {
@@ -169,6 +177,12 @@ typedef enum {
     GB_HIGHPASS_MAX
 } GB_highpass_mode_t;
 
+typedef enum {
+    GB_AUDIO_QUALITY_HIGH, // 64-tap band-limited synthesis
+    GB_AUDIO_QUALITY_MEDIUM, // 16-tap band-limited synthesis
+    GB_AUDIO_QUALITY_LOW, // No band limiting, aliases audibly
+} GB_audio_quality_t;
+
 typedef enum {
     GB_AUDIO_FORMAT_RAW, // Native endian
     GB_AUDIO_FORMAT_AIFF, // Native endian
@@ -196,22 +210,37 @@ typedef struct {
     uint32_t quick_fraction_multiply_cache[GB_QUICK_MULTIPLY_COUNT];
     
     GB_band_limited_t band_limited[GB_N_CHANNELS];
-    double dac_discharge[GB_N_CHANNELS];
+    GB_audio_quality_t quality;
+    const int32_t *band_limited_steps; // Shared between instances
+    unsigned band_limited_width;
+    int32_t dac_discharge[GB_N_CHANNELS]; // 16.16 fixed point, 0 to 1
+    int32_t dac_decay_step, dac_attack_step; // Per sample
     bool channel_muted[GB_N_CHANNELS];
     bool edge_triggered[GB_N_CHANNELS];
 
     GB_highpass_mode_t highpass_mode;
-    double highpass_rate;
-    GB_double_sample_t highpass_diff;
+    int32_t highpass_weight; // 1 - the per-sample decay rate, in 2.30 fixed point
+    GB_fixed_sample_t highpass_diff;
     
     GB_sample_callback_t sample_callback;
+    GB_sample_t *sample_buffer;
+    size_t sample_buffer_size;
+    size_t sample_buffer_position;
+    GB_sample_buffer_callback_t sample_buffer_callback;
     
-    double interference_volume;
-    double interference_highpass;
+    int32_t interference_volume; // 16.16 fixed point
+    int32_t interference_highpass; // 16.16 fixed point
     
-    FILE *output_file;
+    GB_audio_recorder_t *recorder; // Allocated while recording
     GB_audio_format_t output_format;
     int output_error;
+    bool recording_stems;
+    GB_fixed_sample_t stem_highpass_diff[GB_N_CHANNELS];
+    
+    /* While disabled, sample_rate is 0 and the configured rate is kept here */
+    bool disabled;
+    unsigned enabled_sample_rate;
+    unsigned enabled_max_cycles_per_sample;
     
     /* Not output related, but it's temp state so I'll put it here */
     bool square_sweep_disable_stepping;
@@ -224,8 +253,24 @@ unsigned GB_get_sample_rate(GB_gameboy_t *gb);
 void GB_set_sample_rate_by_clocks(GB_gameboy_t *gb, double cycles_per_sample); /* Cycles are in 8MHz units */
 void GB_set_highpass_filter_mode(GB_gameboy_t *gb, GB_highpass_mode_t mode);
 void GB_set_interference_volume(GB_gameboy_t *gb, double volume);
+/* Lower qualities are cheaper to emulate, for hosts that are too weak or don't play the audio back */
+void GB_set_audio_quality(GB_gameboy_t *gb, GB_audio_quality_t quality);
+GB_audio_quality_t GB_get_audio_quality(GB_gameboy_t *gb);
+/* Stops producing samples while keeping all register behavior exact, like setting the sample rate to 0 but keeping
+   the configured rate. Cheaper for instances nobody listens to. Recording is not possible while disabled. */
+void GB_set_audio_disabled(GB_gameboy_t *gb, bool disabled);
+bool GB_is_audio_disabled(GB_gameboy_t *gb);
 void GB_apu_set_sample_callback(GB_gameboy_t *gb, GB_sample_callback_t callback);
+/* Instead of calling the sample callback for every sample, writes samples directly into a buffer of size samples.
+   callback is called with the written samples whenever the buffer is full, and once every frame. Use NULL to go back
+   to the sample callback. */
+void GB_apu_set_sample_buffer(GB_gameboy_t *gb, GB_sample_t *buffer, size_t size, GB_sample_buffer_callback_t callback);
+/* Delivers the samples written to the sample buffer so far, returns their count */
+size_t GB_apu_flush_sample_buffer(GB_gameboy_t *gb);
 int GB_start_audio_recording(GB_gameboy_t *gb, const char *path, GB_audio_format_t format);
+/* Records each channel separately as an 8-channel file, with the stereo pairs in channel order. The stems add up to
+   the mixed output, except for interference. Stopped with GB_stop_audio_recording. */
+int GB_start_audio_stem_recording(GB_gameboy_t *gb, const char *path, GB_audio_format_t format);
 int GB_stop_audio_recording(GB_gameboy_t *gb);
 uint8_t GB_get_channel_volume(GB_gameboy_t *gb, GB_channel_t channel);
 uint8_t GB_get_channel_amplitude(GB_gameboy_t *gb, GB_channel_t channel);
@@ -241,4 +286,5 @@ internal void GB_apu_div_secondary_event(GB_gameboy_t *gb);
 internal void GB_apu_delayed_envelope_tick(GB_gameboy_t *gb);
 internal void GB_apu_init(GB_gameboy_t *gb);
 internal void GB_apu_run(GB_gameboy_t *gb, bool force);
+internal void GB_apu_output_sample(GB_gameboy_t *gb, GB_sample_t *sample);
 #endif
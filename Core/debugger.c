@@ -2178,8 +2178,8 @@ static bool backstep(GB_gameboy_t *gb, char *arguments, char *modifiers, const d
     
     bool didPop = false;
 retry:;
-    typeof(gb->rewind_sequences[0]) *sequence = &gb->rewind_sequences[gb->rewind_pos];
-    if (!gb->rewind_sequences || !sequence->key_state) {
+    GB_rewind_sync(gb);
+    if (!gb->rewind_sequences || !gb->rewind_sequences[gb->rewind_pos].key_state) {
         if (gb->rewind_buffer_length  == 0) {
             GB_log(gb, "Backstepping requires enabling rewinding\n");
         }
@@ -2187,14 +2187,13 @@ retry:;
             GB_log(gb, "Reached the end of the rewind buffer\n");
             if (didPop) {
                 GB_rewind_push(gb);
-                sequence = &gb->rewind_sequences[gb->rewind_pos];
-                sequence->instruction_count[sequence->pos] = 1;
+                gb->rewind_instruction_count = 1;
             }
         }
         return true;
     }
     
-    gb->backstep_instructions = sequence->instruction_count[sequence->pos] - 2;
+    gb->backstep_instructions = gb->rewind_instruction_count - 2;
     if (gb->backstep_instructions == (uint32_t)-1) { // This frame was just pushed, pop it and try again
         GB_rewind_pop(gb);
         gb->backstep_instructions = 0;
@@ -2208,8 +2207,7 @@ retry:;
     }
     GB_rewind_pop(gb);
     GB_rewind_push(gb);
-    sequence = &gb->rewind_sequences[gb->rewind_pos];
-    sequence->instruction_count[sequence->pos] = 1;
+    gb->rewind_instruction_count = 1;
     while (gb->backstep_instructions) {
         GB_run(gb);
     }
@@ -2688,10 +2686,7 @@ next_command:
 void GB_debugger_run(GB_gameboy_t *gb)
 {
 #ifndef DISABLE_REWIND
-    if (gb->rewind_sequences && gb->rewind_sequences[gb->rewind_pos].key_state) {
-        typeof(gb->rewind_sequences[0]) *sequence = &gb->rewind_sequences[gb->rewind_pos];
-        sequence->instruction_count[sequence->pos]++;
-    }
+    gb->rewind_instruction_count++;
     if (unlikely(gb->backstep_instructions)) {
         gb->backstep_instructions--;
         return;
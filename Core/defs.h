@@ -29,6 +29,11 @@
 #define __builtin_bswap16(x) ({ typeof(x) _x = (x); _x >> 8 | _x << 8; })
 #endif
 
+/* Work that's normally offloaded to a thread is done synchronously in builds without pthreads */
+#if defined(_WIN32) && !defined(GB_DISABLE_THREADS)
+#define GB_DISABLE_THREADS
+#endif
+
 #define internal __attribute__((visibility("hidden")))
 #define noinline __attribute__((noinline))
 
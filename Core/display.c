@@ -3,6 +3,11 @@
 #include <assert.h>
 #include <string.h>
 #include <math.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 #include "gb.h"
 
 const GB_palette_t GB_PALETTE_GREY = {{{0x00, 0x00, 0x00}, {0x55, 0x55, 0x55}, {0xAA, 0xAA, 0xAA}, {0xFF, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF}}};
@@ -64,9 +69,27 @@ void GB_set_rgb_encode_callback(GB_gameboy_t *gb, GB_rgb_encode_callback_t callb
 }
 
 void GB_set_pixels_output(GB_gameboy_t *gb, uint32_t *output)
+{
+    GB_set_pixels_output_with_pitch(gb, output, 0);
+}
+
+void GB_set_pixels_output_with_pitch(GB_gameboy_t *gb, uint32_t *output, unsigned pitch)
 {
     GB_ASSERT_NOT_RUNNING_OTHER_THREAD(gb)
     gb->screen = output;
+    gb->screen_pitch = pitch;
+}
+
+unsigned GB_get_screen_pitch(GB_gameboy_t *gb)
+{
+    if (gb->screen_pitch) return gb->screen_pitch;
+    return GB_get_screen_width(gb);
+}
+
+void GB_set_pixel_info_output(GB_gameboy_t *gb, GB_pixel_info_t *output)
+{
+    GB_ASSERT_NOT_RUNNING_OTHER_THREAD(gb)
+    gb->pixel_info = output;
 }
 
 /* FIFO functions */
@@ -122,7 +145,8 @@ static void fifo_push_bg_row(GB_fifo_t *fifo, uint8_t lower, uint8_t upper, uint
     }
 }
 
-static void fifo_overlay_object_row(GB_fifo_t *fifo, uint8_t lower, uint8_t upper, uint8_t palette, bool bg_priority, uint8_t priority, bool flip_x)
+static void fifo_overlay_object_row(GB_fifo_t *fifo, uint8_t lower, uint8_t upper, uint8_t palette, bool bg_priority, uint8_t priority, bool flip_x,
+                                    GB_pixel_info_t *infos, const GB_pixel_info_t *info)
 {
     while (fifo->size < GB_FIFO_LENGTH) {
         fifo->fifo[(fifo->read_end + fifo->size) & (GB_FIFO_LENGTH - 1)] = (GB_fifo_item_t) {0,};
@@ -133,12 +157,16 @@ static void fifo_overlay_object_row(GB_fifo_t *fifo, uint8_t lower, uint8_t uppe
     
     unrolled for (unsigned i = 8; i--;) {
         uint8_t pixel = (lower >> 7) | ((upper >> 7) << 1);
-        GB_fifo_item_t *target = &fifo->fifo[(fifo->read_end + (i ^ flip_xor)) & (GB_FIFO_LENGTH - 1)];
+        uint8_t index = (fifo->read_end + (i ^ flip_xor)) & (GB_FIFO_LENGTH - 1);
+        GB_fifo_item_t *target = &fifo->fifo[index];
         if (pixel != 0 && (target->pixel == 0 || target->priority > priority)) {
             target->pixel = pixel;
             target->palette = palette;
             target->bg_priority = bg_priority;
             target->priority = priority;
+            if (unlikely(infos)) {
+                infos[index] = *info;
+            }
         }
         lower <<= 1;
         upper <<= 1;
@@ -163,6 +191,16 @@ static void fifo_overlay_object_row(GB_fifo_t *fifo, uint8_t lower, uint8_t uppe
 #define BORDERED_HEIGHT 224
 #define VIRTUAL_LINES (LCDC_PERIOD / LINE_LENGTH) // = 154
 
+/* The first pixel of a line in the non-SGB game area of the pixels output */
+static inline uint32_t *screen_line(GB_gameboy_t *gb, unsigned line)
+{
+    unsigned pitch = GB_get_screen_pitch(gb);
+    if (gb->border_mode == GB_BORDER_ALWAYS) {
+        return gb->screen + (BORDERED_WIDTH - WIDTH) / 2 + ((BORDERED_HEIGHT - LINES) / 2 + line) * pitch;
+    }
+    return gb->screen + line * pitch;
+}
+
 typedef struct __attribute__((packed)) {
     uint8_t y;
     uint8_t x;
@@ -196,6 +234,8 @@ void GB_display_vblank(GB_gameboy_t *gb, GB_vblank_type_t type)
         GB_sgb_render(gb, type != GB_VBLANK_TYPE_NORMAL_FRAME);
     }
     
+    GB_apu_flush_sample_buffer(gb);
+    
     if (gb->turbo) {
 #ifndef GB_DISABLE_DEBUGGER
         if (unlikely(gb->backstep_instructions)) return;
@@ -207,6 +247,15 @@ void GB_display_vblank(GB_gameboy_t *gb, GB_vblank_type_t type)
             return;
         }
     }
+    else if (gb->adaptive_frameskip.max_skipped_frames && GB_timing_adaptive_frameskip(gb)) {
+        GB_handle_rumble(gb);
+        
+        if (gb->vblank_callback && gb->enable_skipped_frame_vblank_callbacks) {
+            gb->vblank_callback(gb, GB_VBLANK_TYPE_SKIPPED_FRAME);
+        }
+        GB_timing_sync(gb);
+        return;
+    }
     
     if (GB_is_cgb(gb) && type == GB_VBLANK_TYPE_NORMAL_FRAME && gb->frame_repeat_countdown > 0 && gb->frame_skip_state == GB_FRAMESKIP_LCD_TURNED_ON) {
         GB_handle_rumble(gb);
@@ -232,23 +281,21 @@ void GB_display_vblank(GB_gameboy_t *gb, GB_vblank_type_t type)
                             gb->background_palettes_rgb[0] :
                             gb->background_palettes_rgb[4];
             }
-            if (gb->border_mode == GB_BORDER_ALWAYS) {
-                for (unsigned y = 0; y < LINES; y++) {
-                    for (unsigned x = 0; x < WIDTH; x++) {
-                        gb ->screen[x + y * BORDERED_WIDTH + (BORDERED_WIDTH - WIDTH) / 2 + (BORDERED_HEIGHT - LINES) / 2 * BORDERED_WIDTH] = color;
-                    }
-                }
-            }
-            else {
-                for (unsigned i = 0; i < WIDTH * LINES; i++) {
-                    gb ->screen[i] = color;
+            for (unsigned y = 0; y < LINES; y++) {
+                uint32_t *dest = screen_line(gb, y);
+                for (unsigned x = 0; x < WIDTH; x++) {
+                    dest[x] = color;
                 }
             }
         }
+        if (gb->pixel_info) {
+            memset(gb->pixel_info, 0, sizeof(gb->pixel_info[0]) * WIDTH * LINES);
+        }
     }
     
     if (!gb->disable_rendering && gb->border_mode == GB_BORDER_ALWAYS && !GB_is_sgb(gb)) {
         GB_borrow_sgb_border(gb);
+        unsigned pitch = GB_get_screen_pitch(gb);
         uint32_t border_colors[16 * 4];
         
         if (!gb->has_sgb_border && GB_is_cgb(gb) && gb->model <= GB_MODEL_CGB_E) {
@@ -291,7 +338,7 @@ void GB_display_vblank(GB_gameboy_t *gb, GB_vblank_type_t type)
                                         ((gb->borrowed_border.tiles[base + 1] & bit)  ? 2 : 0) |
                                         ((gb->borrowed_border.tiles[base + 16] & bit) ? 4 : 0) |
                                         ((gb->borrowed_border.tiles[base + 17] & bit) ? 8 : 0);
-                        uint32_t *output = gb->screen + tile_x * 8 + x + (tile_y * 8 + y) * 256;
+                        uint32_t *output = gb->screen + tile_x * 8 + x + (tile_y * 8 + y) * pitch;
                         if (color == 0) {
                             *output = border_colors[0];
                         }
@@ -352,39 +399,55 @@ static inline uint8_t scale_channel_with_curve_sgb(uint8_t x)
 }
 
 
-uint32_t GB_convert_rgb15(GB_gameboy_t *gb, uint16_t color, bool for_border)
+/* Color correction is too slow to run on every palette write, so each combination of correction parameters gets a
+   lazily built table of corrected 24-bit colors, shared between all instances that use the same parameters. The host's
+   RGB encoding is applied on lookup, as encode callbacks are not guaranteed to be pure. */
+
+typedef enum {
+    COLOR_CURVE_LINEAR,
+    COLOR_CURVE_SGB,
+    COLOR_CURVE_CGB,
+    COLOR_CURVE_AGB,
+} color_curve_t;
+
+typedef struct {
+    color_curve_t curve;
+    GB_color_correction_mode_t mode;
+    double temperature;
+} color_table_key_t;
+
+static uint32_t convert_rgb15_uncached(const color_table_key_t *key, uint16_t color)
 {
     uint8_t r = (color) & 0x1F;
     uint8_t g = (color >> 5) & 0x1F;
     uint8_t b = (color >> 10) & 0x1F;
     
-    if (gb->color_correction_mode == GB_COLOR_CORRECTION_DISABLED || (for_border && !gb->has_sgb_border)) {
+    if (key->curve == COLOR_CURVE_LINEAR) {
         r = scale_channel(r);
         g = scale_channel(g);
         b = scale_channel(b);
     }
-    else if (GB_is_sgb(gb) || for_border) {
+    else if (key->curve == COLOR_CURVE_SGB) {
         r = scale_channel_with_curve_sgb(r);
         g = scale_channel_with_curve_sgb(g);
         b = scale_channel_with_curve_sgb(b);
     }
     else {
-        bool agb = gb->model > GB_MODEL_CGB_E;
+        bool agb = key->curve == COLOR_CURVE_AGB;
         r = agb? scale_channel_with_curve_agb(r) : scale_channel_with_curve(r);
         g = agb? scale_channel_with_curve_agb(g) : scale_channel_with_curve(g);
         b = agb? scale_channel_with_curve_agb(b) : scale_channel_with_curve(b);
         
-        if (gb->color_correction_mode != GB_COLOR_CORRECTION_CORRECT_CURVES) {
+        if (key->mode != GB_COLOR_CORRECTION_CORRECT_CURVES) {
             uint8_t new_r, new_g, new_b;
             if (g != b) { // Minor optimization
                 double gamma = 2.2;
-                if (gb->color_correction_mode < GB_COLOR_CORRECTION_REDUCE_CONTRAST) {
+                if (key->mode < GB_COLOR_CORRECTION_REDUCE_CONTRAST) {
                     /* Don't use absolutely gamma-correct mixing for the high-contrast
                        modes, to prevent the blue hues from being too washed out */
                     gamma = 1.6;
                 }
                 
-                // TODO: Optimze pow out using a LUT
                 if (agb) {
                     new_g = round(pow((pow(g / 255.0, gamma) * 5 + pow(b / 255.0, gamma)) / 6, 1 / gamma) * 255);
                 }
@@ -398,7 +461,7 @@ uint32_t GB_convert_rgb15(GB_gameboy_t *gb, uint16_t color, bool for_border)
    
             new_r = r;
             new_b = b;
-            if (gb->color_correction_mode == GB_COLOR_CORRECTION_REDUCE_CONTRAST) {
+            if (key->mode == GB_COLOR_CORRECTION_REDUCE_CONTRAST) {
                 r = new_r;
                 g = new_g;
                 b = new_b;
@@ -418,7 +481,7 @@ uint32_t GB_convert_rgb15(GB_gameboy_t *gb, uint16_t color, bool for_border)
                     new_b = new_b * (216 - 32) / 255 + 32;
                 }
             }
-            else if (gb->color_correction_mode == GB_COLOR_CORRECTION_LOW_CONTRAST) {
+            else if (key->mode == GB_COLOR_CORRECTION_LOW_CONTRAST) {
                 r = new_r;
                 g = new_g;
                 b = new_b;
@@ -438,7 +501,7 @@ uint32_t GB_convert_rgb15(GB_gameboy_t *gb, uint16_t color, bool for_border)
                     new_b = new_b * (157 - 38) / 255 + 38;
                 }
             }
-            else if (gb->color_correction_mode == GB_COLOR_CORRECTION_MODERN_BOOST_CONTRAST) {
+            else if (key->mode == GB_COLOR_CORRECTION_MODERN_BOOST_CONTRAST) {
                 uint8_t old_max = MAX(r, MAX(g, b));
                 uint8_t new_max = MAX(new_r, MAX(new_g, new_b));
                 
@@ -463,15 +526,133 @@ uint32_t GB_convert_rgb15(GB_gameboy_t *gb, uint16_t color, bool for_border)
         }
     }
     
-    if (gb->light_temperature) {
+    if (key->temperature) {
         double light_r, light_g, light_b;
-        temperature_tint(gb->light_temperature, &light_r, &light_g, &light_b);
+        temperature_tint(key->temperature, &light_r, &light_g, &light_b);
         r = round(light_r * r);
         g = round(light_g * g);
         b = round(light_b * b);
     }
     
-    return gb->rgb_encode_callback(gb, r, g, b);
+    return r | (g << 8) | (b << 16);
+}
+
+
+struct GB_color_table_s {
+    struct GB_color_table_s *next;
+    unsigned ref_count;
+    color_table_key_t key;
+    uint32_t colors[0x8000];
+};
+
+static struct GB_color_table_s *color_tables;
+static bool color_tables_lock;
+
+static void lock_color_tables(void)
+{
+    while (__atomic_test_and_set(&color_tables_lock, __ATOMIC_ACQUIRE));
+}
+
+static void unlock_color_tables(void)
+{
+    __atomic_clear(&color_tables_lock, __ATOMIC_RELEASE);
+}
+
+static void color_table_key(GB_gameboy_t *gb, bool for_border, color_table_key_t *key)
+{
+    key->mode = GB_COLOR_CORRECTION_DISABLED;
+    key->temperature = gb->light_temperature;
+    if (gb->color_correction_mode == GB_COLOR_CORRECTION_DISABLED || (for_border && !gb->has_sgb_border)) {
+        key->curve = COLOR_CURVE_LINEAR;
+    }
+    else if (GB_is_sgb(gb) || for_border) {
+        key->curve = COLOR_CURVE_SGB;
+    }
+    else {
+        key->curve = gb->model > GB_MODEL_CGB_E? COLOR_CURVE_AGB : COLOR_CURVE_CGB;
+        key->mode = gb->color_correction_mode;
+    }
+}
+
+static bool color_table_key_equal(const color_table_key_t *a, const color_table_key_t *b)
+{
+    return a->curve == b->curve && a->mode == b->mode && a->temperature == b->temperature;
+}
+
+static void release_color_table(struct GB_color_table_s *table)
+{
+    if (!table) return;
+    lock_color_tables();
+    if (--table->ref_count == 0) {
+        struct GB_color_table_s **link = &color_tables;
+        while (*link != table) {
+            link = &(*link)->next;
+        }
+        *link = table->next;
+        free(table);
+    }
+    unlock_color_tables();
+}
+
+static struct GB_color_table_s *find_color_table(const color_table_key_t *key)
+{
+    for (struct GB_color_table_s *table = color_tables; table; table = table->next) {
+        if (color_table_key_equal(&table->key, key)) {
+            table->ref_count++;
+            return table;
+        }
+    }
+    return NULL;
+}
+
+static struct GB_color_table_s *acquire_color_table(const color_table_key_t *key)
+{
+    lock_color_tables();
+    struct GB_color_table_s *ret = find_color_table(key);
+    unlock_color_tables();
+    if (ret) return ret;
+    
+    // Build outside the lock, another instance might have been faster though
+    struct GB_color_table_s *table = malloc(sizeof(*table));
+    table->key = *key;
+    table->ref_count = 1;
+    nounroll for (unsigned i = 0; i < 0x8000; i++) {
+        table->colors[i] = convert_rgb15_uncached(key, i);
+    }
+    
+    lock_color_tables();
+    ret = find_color_table(key);
+    if (!ret) {
+        table->next = color_tables;
+        color_tables = table;
+        ret = table;
+        table = NULL;
+    }
+    unlock_color_tables();
+    free(table);
+    return ret;
+}
+
+void GB_release_color_tables(GB_gameboy_t *gb)
+{
+    for (unsigned i = 0; i < 2; i++) {
+        release_color_table(gb->color_tables[i]);
+        gb->color_tables[i] = NULL;
+    }
+}
+
+uint32_t GB_convert_rgb15(GB_gameboy_t *gb, uint16_t color, bool for_border)
+{
+    color_table_key_t key;
+    color_table_key(gb, for_border, &key);
+    struct GB_color_table_s *table = gb->color_tables[for_border];
+    if (unlikely(!table || !color_table_key_equal(&table->key, &key))) {
+        release_color_table(table);
+        table = gb->color_tables[for_border] = acquire_color_table(&key);
+    }
+    
+    uint32_t rgb = table->colors[color & 0x7FFF];
+    return gb->rgb_encode_callback(gb, rgb, rgb >> 8, rgb >> 16);
 }
 
 void GB_palette_changed(GB_gameboy_t *gb, bool background_palette, uint8_t index)
@@ -486,6 +667,7 @@ void GB_palette_changed(GB_gameboy_t *gb, bool background_palette, uint8_t index
 void GB_set_color_correction_mode(GB_gameboy_t *gb, GB_color_correction_mode_t mode)
 {
     gb->color_correction_mode = mode;
+    GB_release_color_tables(gb);
     if (GB_is_cgb(gb)) {
         nounroll for (unsigned i = 0; i < 32; i++) {
             GB_palette_changed(gb, false, i * 2);
@@ -497,6 +679,7 @@ void GB_set_color_correction_mode(GB_gameboy_t *gb, GB_color_correction_mode_t m
 void GB_set_light_temperature(GB_gameboy_t *gb, double temperature)
 {
     gb->light_temperature = temperature;
+    GB_release_color_tables(gb);
     if (GB_is_cgb(gb)) {
         nounroll for (unsigned i = 0; i < 32; i++) {
             GB_palette_changed(gb, false, i * 2);
@@ -650,6 +833,28 @@ static void add_object_from_index(GB_gameboy_t *gb, unsigned index)
     }
 }
 
+static inline GB_pixel_info_t bg_pixel_info(bool window, uint8_t tile, uint8_t attributes, uint8_t color)
+{
+    return (GB_pixel_info_t) {
+        .source = window? GB_PIXEL_SOURCE_WINDOW : GB_PIXEL_SOURCE_BACKGROUND,
+        .tile = tile,
+        .attributes = attributes,
+        .palette = attributes & 7,
+        .color = color,
+    };
+}
+
+static inline GB_pixel_info_t object_pixel_info(GB_gameboy_t *gb, uint8_t object_index, uint8_t tile, uint8_t flags)
+{
+    return (GB_pixel_info_t) {
+        .source = GB_PIXEL_SOURCE_OBJECT,
+        .object_index = object_index,
+        .tile = tile,
+        .attributes = flags,
+        .palette = gb->cgb_mode? flags & 7 : (flags & 0x10) >> 4,
+    };
+}
+
 static void render_pixel_if_possible(GB_gameboy_t *gb)
 {
     const GB_fifo_item_t *fifo_item = NULL;
@@ -728,17 +933,27 @@ static void render_pixel_if_possible(GB_gameboy_t *gb)
         fifo_item = &empty_item;
     }
 
-    uint8_t icd_pixel = 0;
-    uint32_t *dest = NULL;
-    if (!gb->sgb) {
-        if (gb->border_mode != GB_BORDER_ALWAYS) {
-            dest = gb->screen + gb->lcd_x + gb->current_line * WIDTH;
+    if (unlikely(gb->pixel_info) && gb->lcd_x < WIDTH && gb->current_line < LINES) {
+        GB_pixel_info_t *info = gb->pixel_info + gb->lcd_x + gb->current_line * WIDTH;
+        if (draw_oam && !(bg_enabled && fifo_item->pixel && bg_priority)) {
+            *info = gb->oam_fifo_info[oam_fifo_item - gb->oam_fifo.fifo];
+            info->color = oam_fifo_item->pixel;
+        }
+        else if (bg_enabled) {
+            *info = gb->bg_fifo_info;
+            info->color = fifo_item->pixel;
         }
         else {
-            dest = gb->screen + gb->lcd_x + gb->current_line * BORDERED_WIDTH + (BORDERED_WIDTH - WIDTH) / 2 + (BORDERED_HEIGHT - LINES) / 2 * BORDERED_WIDTH;
+            *info = (GB_pixel_info_t){GB_PIXEL_SOURCE_NONE,};
         }
     }
     
+    uint8_t icd_pixel = 0;
+    uint32_t *dest = NULL;
+    if (!gb->sgb) {
+        dest = screen_line(gb, gb->current_line) + gb->lcd_x;
+    }
+    
     {
         uint8_t pixel = bg_enabled? fifo_item->pixel : 0;
         if (pixel && bg_priority) {
@@ -1100,6 +1315,9 @@ static void advance_fetcher_state_machine(GB_gameboy_t *gb, unsigned *cycles)
             
             fifo_push_bg_row(&gb->bg_fifo, gb->current_tile_data[0], gb->current_tile_data[1],
                              gb->current_tile_attributes & 7, gb->current_tile_attributes & 0x80, gb->current_tile_attributes & 0x20);
+            if (unlikely(gb->pixel_info)) {
+                gb->bg_fifo_info = bg_pixel_info(gb->wx_triggered, gb->current_tile, gb->current_tile_attributes, 0);
+            }
             gb->fetcher_state = GB_FETCHER_GET_TILE_T1;
         }
         break;
@@ -1165,8 +1383,14 @@ static inline void get_tile_data(const GB_gameboy_t *gb, uint8_t tile_x, uint8_t
 
 static void render_line(GB_gameboy_t *gb)
 {
-    if (gb->disable_rendering) return;
-    if (!gb->screen) return;
+    if (gb->disable_rendering || !gb->screen) {
+        /* No pixels are composed, but the window's line counter must still advance */
+        if (gb->wy_triggered && (gb->io_registers[GB_IO_LCDC] & GB_LCDC_WIN_ENABLE) &&
+            gb->io_registers[GB_IO_WX] >= 7 && gb->io_registers[GB_IO_WX] < 167) {
+            gb->window_y++;
+        }
+        return;
+    }
     if (gb->current_line > 144) return; // Corrupt save state
     
     struct {
@@ -1174,6 +1398,8 @@ static void render_line(GB_gameboy_t *gb)
         unsigned priority:6; // Object priority – 0 in DMG, OAM index in CGB
         unsigned palette:3; // Palette, 0 - 7 (CGB); 0-1 in DMG (or just 0 for BG)
         bool bg_priority:1; // BG priority bit
+        unsigned object:6; // OAM index, for pixel info
+        unsigned tile:8;
     } _object_buffer[160 + 16]; // allocate extra to avoid per pixel checks
     static const uint8_t empty_object_buffer[sizeof(_object_buffer)];
     const typeof(_object_buffer[0]) *object_buffer;
@@ -1211,6 +1437,8 @@ static void render_line(GB_gameboy_t *gb)
                 if (pixel && (!p->pixel || priority < p->priority)) {
                     p->pixel = pixel;
                     p->priority = priority;
+                    p->object = object_index;
+                    p->tile = (line_address & 0x1FFF) >> 4;
                     
                     if (gb->cgb_mode) {
                         p->palette = object->flags & 0x7;
@@ -1229,19 +1457,24 @@ static void render_line(GB_gameboy_t *gb)
     }
     
     
-    uint32_t *restrict p = gb->screen;
+    uint32_t *restrict p = screen_line(gb, gb->current_line);
     typeof(object_buffer[0]) *object_buffer_pointer = object_buffer + 8;
-    if (gb->border_mode == GB_BORDER_ALWAYS) {
-        p += (BORDERED_WIDTH - (WIDTH)) / 2 + BORDERED_WIDTH * (BORDERED_HEIGHT - LINES) / 2;
-        p += BORDERED_WIDTH * gb->current_line;
-    }
-    else {
-        p += WIDTH * gb->current_line;
-    }
+    GB_pixel_info_t *info = gb->pixel_info? gb->pixel_info + WIDTH * gb->current_line : NULL;
     
     if (unlikely(gb->background_disabled) || (!gb->cgb_mode && !(gb->io_registers[GB_IO_LCDC] & GB_LCDC_BG_EN))) {
         uint32_t bg = gb->background_palettes_rgb[gb->cgb_mode? 0 : (gb->io_registers[GB_IO_BGP] & 3)];
         for (unsigned i = 160; i--;) {
+            if (unlikely(info)) {
+                if (object_buffer_pointer->pixel) {
+                    *info = object_pixel_info(gb, object_buffer_pointer->object, object_buffer_pointer->tile,
+                                              ((object_t *)gb->oam)[object_buffer_pointer->object].flags);
+                    info->color = object_buffer_pointer->pixel;
+                }
+                else {
+                    *info = (GB_pixel_info_t){GB_PIXEL_SOURCE_NONE,};
+                }
+                info++;
+            }
             if (unlikely(object_buffer_pointer->pixel)) {
                 uint8_t pixel = object_buffer_pointer->pixel;
                 if (!gb->cgb_mode) {
@@ -1276,12 +1509,20 @@ data1 <<= 1;\
 \
 if (unlikely(object_buffer_pointer->pixel) && (pixel == 0 || !(object_buffer_pointer->bg_priority || (attributes & 0x80)) || !(gb->io_registers[GB_IO_LCDC] & GB_LCDC_BG_EN))) {\
     pixel = object_buffer_pointer->pixel;\
+    if (unlikely(info)) {\
+        *info = object_pixel_info(gb, object_buffer_pointer->object, object_buffer_pointer->tile,\
+                                  ((object_t *)gb->oam)[object_buffer_pointer->object].flags);\
+        (info++)->color = pixel;\
+    }\
     if (!gb->cgb_mode) {\
         pixel = ((gb->io_registers[GB_IO_OBP0 + object_buffer_pointer->palette] >> (pixel << 1)) & 3);\
     }\
     *(p++) = gb->object_palettes_rgb[pixel + (object_buffer_pointer->palette & 7) * 4];\
 }\
 else {\
+    if (unlikely(info)) {\
+        *(info++) = bg_pixel_info(in_window, gb->vram[map + (tile_x & 0x1F) + y / 8 * 32], attributes, pixel);\
+    }\
     if (!gb->cgb_mode) {\
         pixel = ((gb->io_registers[GB_IO_BGP] >> (pixel << 1)) & 3);\
     }\
@@ -1294,10 +1535,12 @@ object_buffer_pointer++\
     data0 <<= fractional_scroll;
     data1 <<= fractional_scroll;
     bool check_window = gb->wy_triggered && (gb->io_registers[GB_IO_LCDC] & GB_LCDC_WIN_ENABLE);
+    bool in_window = false;
     nounroll for (unsigned i = fractional_scroll; i < 8; i++) {
         if (check_window && gb->io_registers[GB_IO_WX] == pixels + 7) {
 activate_window:
             check_window = false;
+            in_window = true;
             map = gb->io_registers[GB_IO_LCDC] & GB_LCDC_WIN_MAP? 0x1C00 : 0x1800;
             tile_x = -1;
             y = ++gb->window_y;
@@ -1340,6 +1583,8 @@ static void render_line_sgb(GB_gameboy_t *gb)
         unsigned pixel:2; // Color, 0-3
         unsigned palette:1; // Palette, 0 - 7 (CGB); 0-1 in DMG (or just 0 for BG)
         bool bg_priority:1; // BG priority bit
+        unsigned object:6; // OAM index, for pixel info
+        unsigned tile:8;
     } _object_buffer[160 + 16]; // allocate extra to avoid per pixel checks
     static const uint8_t empty_object_buffer[sizeof(_object_buffer)];
     const typeof(_object_buffer[0]) *object_buffer;
@@ -1350,7 +1595,8 @@ static void render_line_sgb(GB_gameboy_t *gb)
         memset(_object_buffer, 0, sizeof(_object_buffer));
         
         while (gb->n_visible_objs) {
-            const object_t *object = &objects[gb->visible_objs[gb->n_visible_objs - 1]];
+            unsigned object_index = gb->visible_objs[gb->n_visible_objs - 1];
+            const object_t *object = &objects[object_index];
             gb->n_visible_objs--;
             
             uint16_t line_address = get_object_line_address(gb, object->y, object->tile, object->flags);
@@ -1373,6 +1619,8 @@ static void render_line_sgb(GB_gameboy_t *gb)
                     p->pixel = pixel;
                     p->palette = (object->flags & 0x10) >> 4;
                     p->bg_priority = object->flags & 0x80;
+                    p->object = object_index;
+                    p->tile = (line_address & 0x1FFF) >> 4;
                 }
                 p++;
             }
@@ -1385,10 +1633,22 @@ static void render_line_sgb(GB_gameboy_t *gb)
     
     uint8_t *restrict p = gb->sgb->screen_buffer;
     typeof(object_buffer[0]) *object_buffer_pointer = object_buffer + 8;
+    GB_pixel_info_t *info = gb->pixel_info? gb->pixel_info + WIDTH * gb->current_line : NULL;
     p += WIDTH * gb->current_line;
     
     if (unlikely(gb->background_disabled) || (!gb->cgb_mode && !(gb->io_registers[GB_IO_LCDC] & GB_LCDC_BG_EN))) {
         for (unsigned i = 160; i--;) {
+            if (unlikely(info)) {
+                if (object_buffer_pointer->pixel) {
+                    *info = object_pixel_info(gb, object_buffer_pointer->object, object_buffer_pointer->tile,
+                                              ((object_t *)gb->oam)[object_buffer_pointer->object].flags);
+                    info->color = object_buffer_pointer->pixel;
+                }
+                else {
+                    *info = (GB_pixel_info_t){GB_PIXEL_SOURCE_NONE,};
+                }
+                info++;
+            }
             if (unlikely(object_buffer_pointer->pixel)) {
                 uint8_t pixel = object_buffer_pointer->pixel;
                 pixel = ((gb->io_registers[GB_IO_OBP0 + object_buffer_pointer->palette] >> (pixel << 1)) & 3);
@@ -1421,10 +1681,18 @@ data1 <<= 1;\
 \
 if (unlikely(object_buffer_pointer->pixel) && (pixel == 0 || !object_buffer_pointer->bg_priority || !(gb->io_registers[GB_IO_LCDC] & GB_LCDC_BG_EN))) {\
     pixel = object_buffer_pointer->pixel;\
+    if (unlikely(info)) {\
+        *info = object_pixel_info(gb, object_buffer_pointer->object, object_buffer_pointer->tile,\
+                                  ((object_t *)gb->oam)[object_buffer_pointer->object].flags);\
+        (info++)->color = pixel;\
+    }\
     pixel = ((gb->io_registers[GB_IO_OBP0 + object_buffer_pointer->palette] >> (pixel << 1)) & 3);\
     *(p++) = pixel;\
 }\
 else {\
+    if (unlikely(info)) {\
+        *(info++) = bg_pixel_info(in_window, gb->vram[map + (tile_x & 0x1F) + y / 8 * 32], attributes, pixel);\
+    }\
     pixel = ((gb->io_registers[GB_IO_BGP] >> (pixel << 1)) & 3);\
     *(p++) = pixel;\
 }\
@@ -1435,10 +1703,12 @@ object_buffer_pointer++\
     data0 <<= fractional_scroll;
     data1 <<= fractional_scroll;
     bool check_window = gb->wy_triggered && (gb->io_registers[GB_IO_LCDC] & GB_LCDC_WIN_ENABLE);
+    bool in_window = false;
     nounroll for (unsigned i = fractional_scroll; i < 8; i++) {
         if (check_window && gb->io_registers[GB_IO_WX] == pixels + 7) {
         activate_window:
             check_window = false;
+            in_window = true;
             map = gb->io_registers[GB_IO_LCDC] & GB_LCDC_WIN_MAP? 0x1C00 : 0x1800;
             tile_x = -1;
             y = ++gb->window_y;
@@ -1468,29 +1738,92 @@ object_buffer_pointer++\
     }
 }
 
-static inline uint16_t mode3_batching_length(GB_gameboy_t *gb)
+static inline bool mode3_is_batchable(GB_gameboy_t *gb)
 {
-    if (gb->position_in_line != (uint8_t)-16) return 0;
-    if (gb->model & GB_MODEL_NO_SFC_BIT) return 0;
-    if (gb->hdma_on) return 0;
-    if (gb->stopped) return 0;
-    if (GB_is_dma_active(gb)) return 0;
-    if (gb->wx_triggered) return 0;
+    if (gb->position_in_line != (uint8_t)-16) return false;
+    if (gb->model & GB_MODEL_NO_SFC_BIT) return false;
+    if (gb->hdma_on) return false;
+    if (gb->stopped) return false;
+    if (GB_is_dma_active(gb)) return false;
+    if (gb->wx_triggered) return false;
     if (gb->wy_triggered) {
         if (gb->io_registers[GB_IO_LCDC] & GB_LCDC_WIN_ENABLE) {
             if ((gb->io_registers[GB_IO_WX] < 7 || gb->io_registers[GB_IO_WX] == 166 || gb->io_registers[GB_IO_WX] == 167)) {
-                return 0;
+                return false;
             }
         }
         else {
             if (gb->io_registers[GB_IO_WX] < 167 && !GB_is_cgb(gb)) {
-                return 0;
+                return false;
             }
         }
     }
+    return true;
+}
+
+enum {
+    MODE3_TIMING_OBJ_EN = 1,
+    MODE3_TIMING_WIN_EN = 2,
+    MODE3_TIMING_WY_TRIGGERED = 4,
+    MODE3_TIMING_CGB = 8,
+    MODE3_TIMING_DOUBLE_SPEED = 0x10,
+};
+
+/* Lines with objects or a window don't have a trivial Mode 3 length, but as long as the CPU doesn't interfere with the
+   PPU mid-line, the length only depends on a handful of parameters. The first such line is measured by running the
+   pixel FIFO, and following lines with the same parameters are batched using the measured length. */
+static bool mode3_timing_key(GB_gameboy_t *gb, GB_mode3_timing_t *key)
+{
+    if (gb->wx_just_changed || gb->wy_just_checked || gb->tile_sel_glitch || gb->object_fetch_aborted || gb->insert_bg_pixel) return false;
+    
+    memset(key, 0, sizeof(*key));
+    memcpy(key->objects_x, gb->objects_x, gb->n_visible_objs);
+    key->n_objects = gb->n_visible_objs;
+    key->scx = gb->io_registers[GB_IO_SCX] & 7;
+    key->wx = gb->io_registers[GB_IO_WX];
+    if (gb->io_registers[GB_IO_LCDC] & GB_LCDC_OBJ_EN) {
+        key->flags |= MODE3_TIMING_OBJ_EN;
+    }
+    if (gb->io_registers[GB_IO_LCDC] & GB_LCDC_WIN_ENABLE) {
+        key->flags |= MODE3_TIMING_WIN_EN;
+    }
+    if (gb->wy_triggered) {
+        key->flags |= MODE3_TIMING_WY_TRIGGERED;
+    }
+    if (GB_is_cgb(gb)) {
+        key->flags |= MODE3_TIMING_CGB;
+    }
+    if (gb->cgb_double_speed) {
+        key->flags |= MODE3_TIMING_DOUBLE_SPEED;
+    }
+    return true;
+}
+
+static GB_mode3_timing_t *mode3_timing_entry(GB_gameboy_t *gb, const GB_mode3_timing_t *key)
+{
+    unsigned hash = key->scx ^ (key->wx << 3) ^ (key->flags << 6);
+    for (unsigned i = 0; i < key->n_objects; i++) {
+        hash = hash * 31 + key->objects_x[i];
+    }
+    hash ^= hash >> 5;
+    return &gb->mode3_timing_cache[hash % GB_MODE3_TIMING_CACHE_SIZE];
+}
+
+static inline uint16_t mode3_batching_length(GB_gameboy_t *gb)
+{
+    if (!mode3_is_batchable(gb)) return 0;
 
     // No objects or window, timing is trivial
     if (gb->n_visible_objs == 0 && !(gb->wy_triggered && (gb->io_registers[GB_IO_LCDC] & GB_LCDC_WIN_ENABLE))) return 167 + (gb->io_registers[GB_IO_SCX] & 7);
+    
+    // Timing was already measured for an identical line
+    GB_mode3_timing_t key;
+    if (mode3_timing_key(gb, &key)) {
+        const GB_mode3_timing_t *entry = mode3_timing_entry(gb, &key);
+        if (entry->length && memcmp(entry, &key, offsetof(GB_mode3_timing_t, length)) == 0) {
+            return entry->length;
+        }
+    }
 
     if (gb->hdma_on_hblank) return 0;
     
@@ -1530,8 +1863,54 @@ static void update_frame_parity(GB_gameboy_t *gb)
  TODO: It seems that the STAT register's mode bits are always "late" by 4 T-cycles.
        The PPU logic can be greatly simplified if that delay is simply emulated.
  */
+/* Audio-only mode: keep LY, STAT and the VBlank interrupt running at line granularity, without fetching or drawing
+   anything. Enough for sound drivers, which only care about interrupt timing. */
+static void audio_only_display_run(GB_gameboy_t *gb, unsigned cycles)
+{
+    gb->cycles_since_vblank_callback += cycles / 2;
+    if (!(gb->io_registers[GB_IO_LCDC] & GB_LCDC_ENABLE)) {
+        if (gb->cycles_since_vblank_callback >= LCDC_PERIOD) {
+            GB_display_vblank(gb, GB_VBLANK_TYPE_LCD_OFF);
+        }
+        return;
+    }
+    
+    gb->cycles_for_line += cycles;
+    while (gb->cycles_for_line >= LINE_LENGTH * 2) {
+        gb->cycles_for_line -= LINE_LENGTH * 2;
+        if (++gb->current_line == VIRTUAL_LINES) {
+            gb->current_line = 0;
+        }
+        gb->io_registers[GB_IO_LY] = gb->current_line;
+        gb->ly_for_comparison = gb->current_line;
+        gb->mode_for_interrupt = gb->current_line < LINES? 0 : 1;
+        gb->io_registers[GB_IO_STAT] = (gb->io_registers[GB_IO_STAT] & ~3) | gb->mode_for_interrupt;
+        if (gb->current_line < LINES && gb->hdma_on_hblank) {
+            gb->hdma_on = true;
+        }
+        if (gb->current_line == LINES) {
+            gb->io_registers[GB_IO_IF] |= 1;
+            GB_STAT_update(gb);
+            GB_display_vblank(gb, GB_VBLANK_TYPE_NORMAL_FRAME);
+        }
+        else {
+            GB_STAT_update(gb);
+        }
+    }
+}
+
 void GB_display_run(GB_gameboy_t *gb, unsigned cycles, bool force)
 {
+    if (unlikely(gb->audio_only)) {
+        audio_only_display_run(gb, cycles);
+        return;
+    }
+    
+    if (force) {
+        // The CPU is about to access the PPU, the current line can't be used for measuring Mode 3
+        gb->mode3_timing_cacheable = false;
+    }
+    
     if (gb->wy_triggered) {
         gb->wy_check_scheduled = false;
     }
@@ -1719,12 +2098,7 @@ void GB_display_run(GB_gameboy_t *gb, unsigned cycles, bool force)
         if (gb->current_line < LINES && !GB_is_sgb(gb) && !gb->disable_rendering) {
             GB_log(gb, "The ROM is preventing line %d from fully rendering, this could damage a real device's LCD display.\n", gb->current_line);
             uint32_t *dest = NULL;
-            if (gb->border_mode != GB_BORDER_ALWAYS) {
-                dest = gb->screen + gb->lcd_x + gb->current_line * WIDTH;
-            }
-            else {
-                dest = gb->screen + gb->lcd_x + gb->current_line * BORDERED_WIDTH + (BORDERED_WIDTH - WIDTH) / 2 + (BORDERED_HEIGHT - LINES) / 2 * BORDERED_WIDTH;
-            }
+            dest = screen_line(gb, gb->current_line) + gb->lcd_x;
             uint32_t color = GB_is_cgb(gb)? GB_convert_rgb15(gb, 0x7FFF, false) : gb->background_palettes_rgb[4];
             while (gb->lcd_x < 160) {
                 *(dest++) = color;
@@ -1869,6 +2243,8 @@ void GB_display_run(GB_gameboy_t *gb, unsigned cycles, bool force)
                     goto skip_slow_mode_3;
                 }
             }
+            gb->mode3_timing_cacheable = !force && mode3_is_batchable(gb) && mode3_timing_key(gb, &gb->pending_mode3_timing);
+            gb->mode3_start_cycles = gb->cycles_for_line;
             while (true) {
                 /* Handle window */
                 /* TODO: It appears that WX checks if the window begins *next* pixel, not *this* pixel. For this reason,
@@ -2013,13 +2389,19 @@ void GB_display_run(GB_gameboy_t *gb, unsigned cycles, bool force)
                     if (gb->cgb_mode) {
                         palette = gb->object_flags & 0x7;
                     }
+                    GB_pixel_info_t info;
+                    if (unlikely(gb->pixel_info)) {
+                        info = object_pixel_info(gb, gb->visible_objs[gb->n_visible_objs - 1],
+                                                 (gb->object_low_line_address & 0x1FFF) >> 4, gb->object_flags);
+                    }
                     fifo_overlay_object_row(&gb->oam_fifo,
                                             gb->object_tile_data[0],
                                             gb->object_tile_data[1],
                                             palette,
                                             gb->object_flags & 0x80,
                                             gb->object_priority == GB_OBJECT_PRIORITY_INDEX? gb->visible_objs[gb->n_visible_objs - 1] : 0,
-                                            gb->object_flags & 0x20);
+                                            gb->object_flags & 0x20,
+                                            gb->pixel_info? gb->oam_fifo_info : NULL, &info);
 
                     gb->data_for_sel_glitch = gb->vram_ppu_blocked? 0xFF : gb->vram[gb->object_low_line_address + 1];
                     gb->n_visible_objs--;
@@ -2040,6 +2422,13 @@ abort_fetching_object:
                     GB_STAT_update(gb);
                 }
             }
+            if (gb->mode3_timing_cacheable) {
+                gb->mode3_timing_cacheable = false;
+                gb->pending_mode3_timing.length = gb->cycles_for_line - gb->mode3_start_cycles;
+                if (gb->pending_mode3_timing.length < 300) {
+                    *mode3_timing_entry(gb, &gb->pending_mode3_timing) = gb->pending_mode3_timing;
+                }
+            }
 skip_slow_mode_3:
             gb->position_in_line = -16;
             gb->line_has_fractional_scrolling = false;
@@ -2062,12 +2451,7 @@ skip_slow_mode_3:
             while (gb->lcd_x != 160 && !gb->disable_rendering && gb->screen && !gb->sgb) {
                 /* Oh no! The PPU and LCD desynced! Fill the rest of the line with the last color. */
                 uint32_t *dest = NULL;
-                if (gb->border_mode != GB_BORDER_ALWAYS) {
-                    dest = gb->screen + gb->lcd_x + gb->current_line * WIDTH;
-                }
-                else {
-                    dest = gb->screen + gb->lcd_x + gb->current_line * BORDERED_WIDTH + (BORDERED_WIDTH - WIDTH) / 2 + (BORDERED_HEIGHT - LINES) / 2 * BORDERED_WIDTH;
-                }
+                dest = screen_line(gb, gb->current_line) + gb->lcd_x;
                 *dest = (gb->lcd_x == 0)? gb->background_palettes_rgb[0] : dest[-1];
                 gb->lcd_x++;
 
@@ -2250,7 +2634,62 @@ skip_slow_mode_3:
     }
 }
 
-void GB_draw_tileset(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette_type, uint8_t palette_index)
+void GB_mark_vram_dirty(GB_gameboy_t *gb)
+{
+    gb->vram_version++;
+    nounroll for (unsigned i = 0; i < sizeof(gb->vram_block_version) / sizeof(gb->vram_block_version[0]); i++) {
+        gb->vram_block_version[i] = gb->vram_version;
+    }
+}
+
+/* Incremental viewers compare the final colors they're about to use against the ones they last drew with, so palette
+   data, palette registers and RGB encoding changes are all caught without tracking them separately. */
+static bool vram_view_cache_begin(GB_gameboy_t *gb, GB_vram_view_cache_t *cache, const uint32_t *colors, uint32_t parameters)
+{
+    bool full = !cache->valid ||
+                cache->parameters != parameters ||
+                memcmp(cache->colors, colors, sizeof(cache->colors)) != 0;
+    
+    cache->valid = true;
+    cache->parameters = parameters;
+    memcpy(cache->colors, colors, sizeof(cache->colors));
+    return full;
+}
+
+static inline bool vram_block_dirty(GB_gameboy_t *gb, const GB_vram_view_cache_t *cache, uint16_t address)
+{
+    return gb->vram_block_version[address >> 4] > cache->vram_version;
+}
+
+static void vram_view_cache_end(GB_gameboy_t *gb, GB_vram_view_cache_t *cache)
+{
+    cache->vram_version = gb->vram_version++;
+}
+
+static void get_none_palette(GB_gameboy_t *gb, uint32_t *palette)
+{
+    palette[0] = gb->rgb_encode_callback(gb, 0xFF, 0xFF, 0xFF);
+    palette[1] = gb->rgb_encode_callback(gb, 0xAA, 0xAA, 0xAA);
+    palette[2] = gb->rgb_encode_callback(gb, 0x55, 0x55, 0x55);
+    palette[3] = gb->rgb_encode_callback(gb, 0,    0,    0   );
+}
+
+static inline void draw_vram_tile(GB_gameboy_t *gb, uint32_t *dest, unsigned stride, uint16_t tile_address,
+                                  uint8_t attributes, const uint32_t *colors)
+{
+    for (unsigned y = 0; y < 8; y++) {
+        uint8_t tile_y = (attributes & 0x40)? ~y & 7 : y;
+        uint8_t low = gb->vram[tile_address + tile_y * 2];
+        uint8_t high = gb->vram[tile_address + tile_y * 2 + 1];
+        for (unsigned x = 0; x < 8; x++) {
+            uint8_t bit = (attributes & 0x20)? x : ~x & 7;
+            dest[x] = colors[((low >> bit) & 1) | (((high >> bit) & 1) << 1)];
+        }
+        dest += stride;
+    }
+}
+
+void GB_draw_tileset_cached(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette_type, uint8_t palette_index, GB_vram_view_cache_t *cache)
 {
     uint32_t none_palette[4];
     uint32_t *palette = NULL;
@@ -2258,10 +2697,7 @@ void GB_draw_tileset(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette
     switch (GB_is_cgb(gb)? palette_type : GB_PALETTE_NONE) {
         default:
         case GB_PALETTE_NONE:
-            none_palette[0] = gb->rgb_encode_callback(gb, 0xFF, 0xFF, 0xFF);
-            none_palette[1] = gb->rgb_encode_callback(gb, 0xAA, 0xAA, 0xAA);
-            none_palette[2] = gb->rgb_encode_callback(gb, 0x55, 0x55, 0x55);
-            none_palette[3] = gb->rgb_encode_callback(gb, 0,    0,    0   );
+            get_none_palette(gb, none_palette);
             palette = none_palette;
             break;
         case GB_PALETTE_BACKGROUND:
@@ -2272,35 +2708,55 @@ void GB_draw_tileset(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette
             break;
     }
     
-    for (unsigned y = 0; y < 192; y++) {
-        for (unsigned x = 0; x < 256; x++) {
-            if (x >= 128 && !GB_is_cgb(gb)) {
-                *(dest++) = gb->background_palettes_rgb[0];
-                continue;
+    // The first 4 colors are indexed by the raw pixel value, the last one fills the missing bank on DMGs
+    uint32_t colors[sizeof(cache->colors) / sizeof(cache->colors[0])] = {0,};
+    for (unsigned pixel = 0; pixel < 4; pixel++) {
+        uint8_t mapped = pixel;
+        if (!gb->cgb_mode) {
+            if (palette_type == GB_PALETTE_BACKGROUND) {
+                mapped = ((gb->io_registers[GB_IO_BGP] >> (pixel << 1)) & 3);
             }
-            uint16_t tile = (x % 128) / 8 + y / 8 * 16;
-            uint16_t tile_address = tile * 0x10 + (x >= 128? 0x2000 : 0);
-            uint8_t pixel = (((gb->vram[tile_address + (y & 7) * 2    ] >> ((~x)&7)) & 1 ) |
-                             ((gb->vram[tile_address + (y & 7) * 2 + 1] >> ((~x)&7)) & 1) << 1);
-            
-            if (!gb->cgb_mode) {
-                if (palette_type == GB_PALETTE_BACKGROUND) {
-                    pixel = ((gb->io_registers[GB_IO_BGP] >> (pixel << 1)) & 3);
-                }
-                else if (!gb->cgb_mode) {
-                    if (palette_type == GB_PALETTE_OAM) {
-                        pixel = ((gb->io_registers[palette_index == 0? GB_IO_OBP0 : GB_IO_OBP1] >> (pixel << 1)) & 3);
-                    }
+            else if (palette_type == GB_PALETTE_OAM) {
+                mapped = ((gb->io_registers[palette_index == 0? GB_IO_OBP0 : GB_IO_OBP1] >> (pixel << 1)) & 3);
+            }
+        }
+        colors[pixel] = palette[mapped];
+    }
+    colors[4] = gb->background_palettes_rgb[0];
+    
+    GB_vram_view_cache_t temp_cache;
+    if (!cache) {
+        cache = &temp_cache;
+        cache->valid = false;
+    }
+    bool full = vram_view_cache_begin(gb, cache, colors, GB_is_cgb(gb));
+    
+    for (unsigned bank = 0; bank < 2; bank++) {
+        if (bank && !GB_is_cgb(gb)) {
+            if (!full) break;
+            for (unsigned y = 0; y < 192; y++) {
+                for (unsigned x = 128; x < 256; x++) {
+                    dest[x + y * 256] = colors[4];
                 }
             }
-            
-            
-            *(dest++) = palette[pixel];
+            break;
+        }
+        for (unsigned tile = 0; tile < 384; tile++) {
+            uint16_t tile_address = tile * 0x10 + bank * 0x2000;
+            if (!full && !vram_block_dirty(gb, cache, tile_address)) continue;
+            draw_vram_tile(gb, dest + (tile % 16) * 8 + bank * 128 + tile / 16 * 8 * 256, 256, tile_address, 0, colors);
         }
     }
+    
+    vram_view_cache_end(gb, cache);
 }
 
-void GB_draw_tilemap(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette_type, uint8_t palette_index, GB_map_type_t map_type, GB_tileset_type_t tileset_type)
+void GB_draw_tileset(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette_type, uint8_t palette_index)
+{
+    GB_draw_tileset_cached(gb, dest, palette_type, palette_index, NULL);
+}
+
+void GB_draw_tilemap_cached(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette_type, uint8_t palette_index, GB_map_type_t map_type, GB_tileset_type_t tileset_type, GB_vram_view_cache_t *cache)
 {
     uint32_t none_palette[4];
     uint32_t *palette = NULL;
@@ -2308,10 +2764,7 @@ void GB_draw_tilemap(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette
     
     switch (GB_is_cgb(gb)? palette_type : GB_PALETTE_NONE) {
         case GB_PALETTE_NONE:
-            none_palette[0] = gb->rgb_encode_callback(gb, 0xFF, 0xFF, 0xFF);
-            none_palette[1] = gb->rgb_encode_callback(gb, 0xAA, 0xAA, 0xAA);
-            none_palette[2] = gb->rgb_encode_callback(gb, 0x55, 0x55, 0x55);
-            none_palette[3] = gb->rgb_encode_callback(gb, 0,    0,    0   );
+            get_none_palette(gb, none_palette);
             palette = none_palette;
             break;
         case GB_PALETTE_BACKGROUND:
@@ -2332,42 +2785,59 @@ void GB_draw_tilemap(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette
         tileset_type = (gb->io_registers[GB_IO_LCDC] & GB_LCDC_TILE_SEL)? GB_TILESET_8800 : GB_TILESET_8000;
     }
     
-    for (unsigned y = 0; y < 256; y++) {
-        for (unsigned x = 0; x < 256; x++) {
-            uint8_t tile = gb->vram[map + x/8 + y/8 * 32];
-            uint16_t tile_address;
-            uint8_t attributes = 0;
-            
-            if (tileset_type == GB_TILESET_8800) {
-                tile_address = tile * 0x10;
-            }
-            else {
-                tile_address = (int8_t) tile * 0x10 + 0x1000;
-            }
-            
-            if (gb->cgb_mode) {
-                attributes = gb->vram[map + x/8 + y/8 * 32 + 0x2000];
-            }
-            
-            if (attributes & 0x8) {
-                tile_address += 0x2000;
-            }
-            
-            uint8_t pixel = (((gb->vram[tile_address + (((attributes & 0x40)? ~y : y) & 7) * 2    ] >> (((attributes & 0x20)? x : ~x)&7)) & 1 ) |
-                             ((gb->vram[tile_address + (((attributes & 0x40)? ~y : y) & 7) * 2 + 1] >> (((attributes & 0x20)? x : ~x)&7)) & 1) << 1);
-            
-            if (!gb->cgb_mode && (palette_type == GB_PALETTE_BACKGROUND || palette_type == GB_PALETTE_AUTO)) {
-                pixel = ((gb->io_registers[GB_IO_BGP] >> (pixel << 1)) & 3);
-            }
-            
-            if (palette) {
-                *(dest++) = palette[pixel];
-            }
-            else {
-                *(dest++) = gb->background_palettes_rgb[(attributes & 7) * 4 + pixel];
-            }
+    // Indexed by the attributes' palette and the raw pixel value
+    uint32_t colors[sizeof(cache->colors) / sizeof(cache->colors[0])] = {0,};
+    for (unsigned i = 0; i < 8 * 4; i++) {
+        uint8_t pixel = i & 3;
+        if (!gb->cgb_mode && (palette_type == GB_PALETTE_BACKGROUND || palette_type == GB_PALETTE_AUTO)) {
+            pixel = ((gb->io_registers[GB_IO_BGP] >> (pixel << 1)) & 3);
+        }
+        colors[i] = palette? palette[pixel] : gb->background_palettes_rgb[(i & ~3) + pixel];
+    }
+    
+    GB_vram_view_cache_t temp_cache;
+    if (!cache) {
+        cache = &temp_cache;
+        cache->valid = false;
+    }
+    bool full = vram_view_cache_begin(gb, cache, colors, map | tileset_type << 16 | gb->cgb_mode << 24);
+    
+    for (unsigned i = 0; i < 32 * 32; i++) {
+        uint8_t tile = gb->vram[map + i];
+        uint16_t tile_address;
+        uint8_t attributes = 0;
+        
+        if (tileset_type == GB_TILESET_8800) {
+            tile_address = tile * 0x10;
+        }
+        else {
+            tile_address = (int8_t) tile * 0x10 + 0x1000;
+        }
+        
+        if (gb->cgb_mode) {
+            attributes = gb->vram[map + i + 0x2000];
+        }
+        
+        if (attributes & 0x8) {
+            tile_address += 0x2000;
+        }
+        
+        if (!full &&
+            !vram_block_dirty(gb, cache, map + i) &&
+            !vram_block_dirty(gb, cache, map + i + 0x2000) &&
+            !vram_block_dirty(gb, cache, tile_address)) {
+            continue;
         }
+        
+        draw_vram_tile(gb, dest + (i % 32) * 8 + i / 32 * 8 * 256, 256, tile_address, attributes, colors + (attributes & 7) * 4);
     }
+    
+    vram_view_cache_end(gb, cache);
+}
+
+void GB_draw_tilemap(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette_type, uint8_t palette_index, GB_map_type_t map_type, GB_tileset_type_t tileset_type)
+{
+    GB_draw_tilemap_cached(gb, dest, palette_type, palette_index, map_type, tileset_type, NULL);
 }
 
 uint8_t GB_get_oam_info(GB_gameboy_t *gb, GB_oam_info_t *dest, uint8_t *object_height)
@@ -2441,6 +2911,115 @@ bool GB_is_odd_frame(GB_gameboy_t *gb)
     return gb->is_odd_frame;
 }
 
+/* Frame blending mixes channels in linear light, like Shaders/MasterShader.fsh. The gamma-correct mix of every pair of
+   8-bit channel values is precomputed, once for an even mix and once for a 2:1 mix, and shared between instances. */
+
+#define BLEND_GAMMA 2.2
+
+static uint8_t blend_half[256][256];
+static uint8_t blend_third[256][256]; // [current][previous], previous weighs a third
+static bool blend_tables_ready = false;
+
+static void build_blend_tables(void)
+{
+    if (__atomic_load_n(&blend_tables_ready, __ATOMIC_ACQUIRE)) return;
+    double linear[256];
+    for (unsigned i = 0; i < 256; i++) {
+        linear[i] = pow(i / 255.0, BLEND_GAMMA);
+    }
+    for (unsigned current = 0; current < 256; current++) {
+        for (unsigned previous = 0; previous < 256; previous++) {
+            blend_half[current][previous] = round(pow((linear[current] + linear[previous]) / 2, 1 / BLEND_GAMMA) * 255);
+            blend_third[current][previous] = round(pow((linear[current] * 2 + linear[previous]) / 3, 1 / BLEND_GAMMA) * 255);
+        }
+    }
+    // Concurrent builders write identical values, so publishing twice is harmless
+    __atomic_store_n(&blend_tables_ready, true, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t blend_pixel(uint32_t current, uint32_t previous, uint8_t (*table)[256], bool swap)
+{
+    if (current == previous) return current;
+    uint32_t ret = 0;
+    for (unsigned shift = 0; shift < 32; shift += 8) {
+        uint8_t a = current >> shift;
+        uint8_t b = previous >> shift;
+        ret |= (uint32_t)(swap? table[b][a] : table[a][b]) << shift;
+    }
+    return ret;
+}
+
+/* Pixels that did not change since the previous frame are by far the common case, so they are detected several at a
+   time and copied as-is; only changed pixels go through the tables. */
+static void blend_row(uint32_t *dest, const uint32_t *current, const uint32_t *previous, unsigned width,
+                      uint8_t (*table)[256], bool swap)
+{
+    unsigned x = 0;
+#if defined(__SSE2__)
+    for (; x + 4 <= width; x += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(current + x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(previous + x));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, b)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i *)(dest + x), a);
+            continue;
+        }
+        for (unsigned i = 0; i < 4; i++) {
+            dest[x + i] = blend_pixel(current[x + i], previous[x + i], table, swap);
+        }
+    }
+#elif defined(__ARM_NEON)
+    for (; x + 4 <= width; x += 4) {
+        uint32x4_t a = vld1q_u32(current + x);
+        uint32x4_t b = vld1q_u32(previous + x);
+        uint32x4_t equal = vceqq_u32(a, b);
+        if (vgetq_lane_u64(vreinterpretq_u64_u32(equal), 0) == UINT64_MAX &&
+            vgetq_lane_u64(vreinterpretq_u64_u32(equal), 1) == UINT64_MAX) {
+            vst1q_u32(dest + x, a);
+            continue;
+        }
+        for (unsigned i = 0; i < 4; i++) {
+            dest[x + i] = blend_pixel(current[x + i], previous[x + i], table, swap);
+        }
+    }
+#endif
+    for (; x < width; x++) {
+        dest[x] = blend_pixel(current[x], previous[x], table, swap);
+    }
+}
+
+GB_frame_blending_mode_t GB_get_effective_frame_blending_mode(GB_gameboy_t *gb, GB_frame_blending_mode_t mode)
+{
+    if (mode != GB_FRAME_BLENDING_MODE_ACCURATE) return mode;
+    if (GB_is_sgb(gb)) return GB_FRAME_BLENDING_MODE_SIMPLE;
+    return gb->is_odd_frame? GB_FRAME_BLENDING_MODE_ACCURATE_ODD : GB_FRAME_BLENDING_MODE_ACCURATE_EVEN;
+}
+
+void GB_blend_frames(GB_gameboy_t *gb, uint32_t *dest, const uint32_t *current, const uint32_t *previous,
+                     GB_frame_blending_mode_t mode)
+{
+    unsigned width = GB_get_screen_width(gb);
+    unsigned height = GB_get_screen_height(gb);
+    
+    if (mode == GB_FRAME_BLENDING_MODE_DISABLED || !previous) {
+        if (dest != current) {
+            memcpy(dest, current, width * height * sizeof(*dest));
+        }
+        return;
+    }
+    
+    build_blend_tables();
+    for (unsigned y = 0; y < height; y++) {
+        uint8_t (*table)[256] = blend_third;
+        // Even rows weigh the previous frame by a third in ACCURATE_EVEN, odd rows by two thirds
+        bool swap = (y & 1) ^ (mode == GB_FRAME_BLENDING_MODE_ACCURATE_ODD);
+        if (mode == GB_FRAME_BLENDING_MODE_SIMPLE) {
+            table = blend_half;
+            swap = false;
+        }
+        blend_row(dest + y * width, current + y * width, previous + y * width, width, table, swap);
+    }
+}
+
 void GB_set_object_rendering_disabled(GB_gameboy_t *gb, bool disabled)
 {
     gb->objects_disabled = disabled;
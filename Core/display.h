@@ -20,7 +20,7 @@ typedef enum {
     GB_VBLANK_TYPE_LCD_OFF, // An artificial frame pushed while the LCD was off
     GB_VBLANK_TYPE_ARTIFICIAL, // An artificial frame pushed for some other reason
     GB_VBLANK_TYPE_REPEAT, // A frame that would not render on actual hardware, but the screen should retain the previous frame
-    GB_VBLANK_TYPE_SKIPPED_FRAME, // If enabled via GB_set_enable_skipped_frame_vblank_callbacks, called on skipped frames during turbo mode
+    GB_VBLANK_TYPE_SKIPPED_FRAME, // If enabled via GB_set_enable_skipped_frame_vblank_callbacks, called on skipped frames during turbo mode or adaptive frameskip
 } GB_vblank_type_t;
 
 typedef void (*GB_vblank_callback_t)(GB_gameboy_t *gb, GB_vblank_type_t type);
@@ -40,6 +40,35 @@ typedef struct {
     uint8_t size;
 } GB_fifo_t;
 
+typedef enum {
+    GB_PIXEL_SOURCE_NONE, // Blank, i.e. the LCD is off or the background is disabled on a DMG
+    GB_PIXEL_SOURCE_BACKGROUND,
+    GB_PIXEL_SOURCE_WINDOW,
+    GB_PIXEL_SOURCE_OBJECT,
+} GB_pixel_source_t;
+
+/* Describes where a pixel in the pixels output came from */
+typedef struct {
+    uint8_t source; // GB_pixel_source_t
+    uint8_t object_index; // OAM index, objects only
+    uint8_t tile; // Tile number, as stored in the tilemap or OAM
+    uint8_t attributes; // CGB tile attributes, or object flags
+    uint8_t palette; // Palette, 0 - 7 (CGB); 0-1 for objects in DMG (or just 0 for BG)
+    uint8_t color; // Color, 0-3, before applying the palette
+} GB_pixel_info_t;
+
+/* Everything that affects the length of Mode 3 when it's not disturbed by CPU accesses */
+typedef struct {
+    uint8_t objects_x[10];
+    uint8_t n_objects;
+    uint8_t scx;
+    uint8_t wx;
+    uint8_t flags;
+    uint16_t length; // 0 if unused
+} GB_mode3_timing_t;
+
+#define GB_MODE3_TIMING_CACHE_SIZE 256
+
 #ifdef GB_INTERNAL
 internal void GB_display_run(GB_gameboy_t *gb, unsigned cycles, bool force);
 internal void GB_palette_changed(GB_gameboy_t *gb, bool background_palette, uint8_t index);
@@ -48,7 +77,10 @@ internal void GB_lcd_off(GB_gameboy_t *gb);
 internal void GB_display_vblank(GB_gameboy_t *gb, GB_vblank_type_t type);
 internal void GB_update_wx_glitch(GB_gameboy_t *gb);
 internal void GB_update_dmg_palette(GB_gameboy_t *gb);
+internal void GB_release_color_tables(GB_gameboy_t *gb);
+internal void GB_mark_vram_dirty(GB_gameboy_t *gb);
 #define GB_display_sync(gb) GB_display_run(gb, 0, true)
+#define GB_vram_written(gb, addr) ((gb)->vram_block_version[(addr) >> 4] = (gb)->vram_version)
 
 enum {
   GB_OBJECT_PRIORITY_X,
@@ -75,6 +107,15 @@ typedef enum {
     GB_TILESET_8000,
 } GB_tileset_type_t;
 
+/* State for incrementally redrawing a tileset or tilemap into a persistent buffer. Zero it before first use, and keep
+   using it with the same buffer and the same instance. */
+typedef struct {
+    uint32_t colors[8 * 4 + 1];
+    uint32_t parameters;
+    uint32_t vram_version;
+    bool valid;
+} GB_vram_view_cache_t;
+
 typedef struct {
     uint32_t image[128];
     uint8_t x, y, tile, flags;
@@ -92,6 +133,14 @@ typedef enum {
     GB_COLOR_CORRECTION_MODERN_ACCURATE,
 } GB_color_correction_mode_t;
 
+typedef enum {
+    GB_FRAME_BLENDING_MODE_DISABLED,
+    GB_FRAME_BLENDING_MODE_SIMPLE,
+    GB_FRAME_BLENDING_MODE_ACCURATE,
+    GB_FRAME_BLENDING_MODE_ACCURATE_EVEN = GB_FRAME_BLENDING_MODE_ACCURATE,
+    GB_FRAME_BLENDING_MODE_ACCURATE_ODD,
+} GB_frame_blending_mode_t;
+
 static const GB_color_correction_mode_t __attribute__((deprecated("Use GB_COLOR_CORRECTION_MODERN_BALANCED instead"))) GB_COLOR_CORRECTION_EMULATE_HARDWARE = GB_COLOR_CORRECTION_MODERN_BALANCED;
 static const GB_color_correction_mode_t __attribute__((deprecated("Use GB_COLOR_CORRECTION_MODERN_BOOST_CONTRAST instead"))) GB_COLOR_CORRECTION_PRESERVE_BRIGHTNESS = GB_COLOR_CORRECTION_MODERN_BOOST_CONTRAST;
 
@@ -103,16 +152,28 @@ const GB_palette_t *GB_get_palette(GB_gameboy_t *gb);
 void GB_set_color_correction_mode(GB_gameboy_t *gb, GB_color_correction_mode_t mode);
 void GB_set_light_temperature(GB_gameboy_t *gb, double temperature);
 void GB_set_pixels_output(GB_gameboy_t *gb, uint32_t *output);
+/* Like GB_set_pixels_output, but rows are pitch pixels apart (0 for tightly packed rows) */
+void GB_set_pixels_output_with_pitch(GB_gameboy_t *gb, uint32_t *output, unsigned pitch);
+/* An optional 160x144 output describing each pixel's source, or NULL to disable */
+void GB_set_pixel_info_output(GB_gameboy_t *gb, GB_pixel_info_t *output);
 
 unsigned GB_get_screen_width(GB_gameboy_t *gb);
 unsigned GB_get_screen_height(GB_gameboy_t *gb);
+unsigned GB_get_screen_pitch(GB_gameboy_t *gb);
 double GB_get_usual_frame_rate(GB_gameboy_t *gb);
 
 bool GB_is_odd_frame(GB_gameboy_t *gb);
+/* Resolves GB_FRAME_BLENDING_MODE_ACCURATE into the mode the current frame should be blended with */
+GB_frame_blending_mode_t GB_get_effective_frame_blending_mode(GB_gameboy_t *gb, GB_frame_blending_mode_t mode);
+/* Blends two tightly packed frames on the CPU, matching the shaders. dest may be the same buffer as current. */
+void GB_blend_frames(GB_gameboy_t *gb, uint32_t *dest, const uint32_t *current, const uint32_t *previous, GB_frame_blending_mode_t mode);
 uint32_t GB_convert_rgb15(GB_gameboy_t *gb, uint16_t color, bool for_border);
 
 void GB_draw_tileset(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette_type, uint8_t palette_index);
 void GB_draw_tilemap(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette_type, uint8_t palette_index, GB_map_type_t map_type, GB_tileset_type_t tileset_type);
+/* Only redraw tiles affected by VRAM writes since the last call with the same cache */
+void GB_draw_tileset_cached(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette_type, uint8_t palette_index, GB_vram_view_cache_t *cache);
+void GB_draw_tilemap_cached(GB_gameboy_t *gb, uint32_t *dest, GB_palette_type_t palette_type, uint8_t palette_index, GB_map_type_t map_type, GB_tileset_type_t tileset_type, GB_vram_view_cache_t *cache);
 uint8_t GB_get_oam_info(GB_gameboy_t *gb, GB_oam_info_t *dest, uint8_t *object_height);
 
 void GB_set_object_rendering_disabled(GB_gameboy_t *gb, bool disabled);
@@ -218,6 +218,10 @@ void GB_free(GB_gameboy_t *gb)
     if (gb->sgb) {
         free(gb->sgb);
     }
+    if (gb->sgb_border_cache) {
+        free(gb->sgb_border_cache);
+    }
+    GB_sgb_release_jingles(gb);
 #ifndef GB_DISABLE_DEBUGGER
     GB_debugger_clear_symbols(gb);
     if (gb->breakpoints) {
@@ -241,6 +245,9 @@ void GB_free(GB_gameboy_t *gb)
     GB_cheat_search_reset(gb);
 #endif
     GB_stop_audio_recording(gb);
+    GB_stop_vgm_logging(gb);
+    GB_vgm_player_free(gb);
+    GB_release_color_tables(gb);
         memset(gb, 0, sizeof(*gb));
 }
 
@@ -1191,6 +1198,13 @@ unsigned GB_run(GB_gameboy_t *gb)
 {
     GB_ASSERT_NOT_RUNNING(gb)
     gb->vblank_just_occured = false;
+    
+    if (unlikely(gb->vgm_player)) {
+        GB_set_running_thread(gb);
+        unsigned cycles = GB_vgm_player_run(gb);
+        GB_clear_running_thread(gb);
+        return cycles;
+    }
 
     if (unlikely(gb->sgb && gb->sgb->intro_animation < 96)) {
         /* On the SGB, the GB is halted after finishing the boot ROM.
@@ -1425,6 +1439,17 @@ bool GB_is_hle_sgb(GB_gameboy_t *gb)
 
 void GB_set_turbo_mode(GB_gameboy_t *gb, bool on, bool no_frame_skip)
 {
+    /* The frame skipper doesn't run in turbo mode, don't let it keep rendering disabled, and don't let it measure
+       the first frame after turbo against a stale timestamp */
+    if (on && gb->adaptive_frameskip.skipping) {
+        gb->disable_rendering = false;
+        gb->adaptive_frameskip.skipping = false;
+        gb->adaptive_frameskip.countdown = 0;
+    }
+    if (on != gb->turbo) {
+        gb->adaptive_frameskip.frame_start = 0;
+        gb->adaptive_frameskip.slept_nanoseconds = 0;
+    }
     gb->turbo = on;
     gb->turbo_dont_skip = no_frame_skip;
 }
@@ -1437,6 +1462,31 @@ void GB_set_turbo_cap(GB_gameboy_t *gb, double multiplier)
 void GB_set_rendering_disabled(GB_gameboy_t *gb, bool disabled)
 {
     gb->disable_rendering = disabled;
+    gb->adaptive_frameskip.skipping = false;
+}
+
+void GB_set_audio_only_mode(GB_gameboy_t *gb, bool enabled)
+{
+    GB_ASSERT_NOT_RUNNING_OTHER_THREAD(gb)
+    if (gb->audio_only == enabled) return;
+    gb->audio_only = enabled;
+    GB_set_rendering_disabled(gb, enabled);
+    /* Both models keep their own state, restart from the top of the frame */
+    GB_lcd_off(gb);
+}
+
+void GB_set_adaptive_frameskip(GB_gameboy_t *gb, unsigned max_skipped_frames)
+{
+    if (gb->adaptive_frameskip.skipping) {
+        gb->disable_rendering = false;
+    }
+    memset(&gb->adaptive_frameskip, 0, sizeof(gb->adaptive_frameskip));
+    gb->adaptive_frameskip.max_skipped_frames = max_skipped_frames;
+}
+
+void GB_set_audio_sync_callback(GB_gameboy_t *gb, GB_audio_sync_callback_t callback)
+{
+    gb->audio_sync_callback = callback;
 }
 
 void *GB_get_user_data(GB_gameboy_t *gb)
@@ -1704,6 +1754,7 @@ static void GB_reset_internal(GB_gameboy_t *gb, bool quick)
         preserved_state->obp1 = gb->io_registers[GB_IO_OBP1];
     }
     
+    GB_vgm_player_free(gb);
     uint32_t mbc_ram_size = gb->mbc_ram_size;
     GB_model_t model = gb->model;
     GB_update_clock_rate(gb);
@@ -1734,6 +1785,7 @@ static void GB_reset_internal(GB_gameboy_t *gb, bool quick)
         gb->object_priority = GB_OBJECT_PRIORITY_X;        
         GB_update_dmg_palette(gb);
     }
+    GB_mark_vram_dirty(gb);
     
     gb->serial_mask = 0x80;
     gb->io_registers[GB_IO_SC] = 0x7E;
@@ -1745,9 +1797,6 @@ static void GB_reset_internal(GB_gameboy_t *gb, bool quick)
             gb->sgb = malloc(sizeof(*gb->sgb));
         }
         memset(gb->sgb, 0, sizeof(*gb->sgb));
-        memset(gb->sgb_intro_jingle_phases, 0, sizeof(gb->sgb_intro_jingle_phases));
-        gb->sgb_intro_sweep_phase = 0;
-        gb->sgb_intro_sweep_previous_sample = 0;
         gb->sgb->intro_animation = -10;
         
         gb->sgb->player_count = 1;
@@ -1759,6 +1808,10 @@ static void GB_reset_internal(GB_gameboy_t *gb, bool quick)
             free(gb->sgb);
             gb->sgb = NULL;
         }
+        if (gb->sgb_border_cache) {
+            free(gb->sgb_border_cache);
+            gb->sgb_border_cache = NULL;
+        }
     }
     
     GB_set_internal_div_counter(gb, 8);
@@ -1867,6 +1920,8 @@ void *GB_get_direct_access(GB_gameboy_t *gb, GB_direct_access_t access, size_t *
             *bank = gb->mbc_ram_bank & (gb->mbc_ram_size / 0x2000 - 1);
             return gb->mbc_ram;
         case GB_DIRECT_ACCESS_VRAM:
+            // The host might write to it
+            GB_mark_vram_dirty(gb);
             *size = gb->vram_size;
             *bank = gb->cgb_vram_bank;
             return gb->vram;
@@ -1941,7 +1996,7 @@ void GB_update_clock_rate(GB_gameboy_t *gb)
     }
     
     gb->clock_rate = gb->unmultiplied_clock_rate * gb->clock_multiplier;
-    GB_set_sample_rate(gb, gb->apu_output.sample_rate);
+    GB_set_sample_rate(gb, GB_get_sample_rate(gb));
 }
 
 void GB_set_border_mode(GB_gameboy_t *gb, GB_border_mode_t border_mode)
@@ -41,6 +41,8 @@ extern "C" {
 #include "rumble.h"
 #include "workboy.h"
 #include "random.h"
+#include "scaler.h"
+#include "vgm.h"
 
 #ifdef GB_INTERNAL
 #define STRUCT_VERSION 15
@@ -284,6 +286,7 @@ typedef void (*GB_boot_rom_load_callback_t)(GB_gameboy_t *gb, GB_boot_rom_t type
 typedef void (*GB_execution_callback_t)(GB_gameboy_t *gb, uint16_t address, uint8_t opcode);
 typedef void (*GB_lcd_line_callback_t)(GB_gameboy_t *gb, uint8_t line);
 typedef void (*GB_lcd_status_callback_t)(GB_gameboy_t *gb, bool on);
+typedef bool (*GB_audio_sync_callback_t)(GB_gameboy_t *gb);
 
 struct GB_breakpoint_s;
 struct GB_watchpoint_s;
@@ -672,11 +675,16 @@ struct GB_gameboy_internal_s {
 
         /* I/O */
         uint32_t *screen;
+        unsigned screen_pitch; // In pixels, 0 if tightly packed
+        GB_pixel_info_t *pixel_info;
+        GB_pixel_info_t bg_fifo_info;
+        GB_pixel_info_t oam_fifo_info[GB_FIFO_LENGTH];
         uint32_t background_palettes_rgb[0x20];
         uint32_t object_palettes_rgb[0x20];
         const GB_palette_t *dmg_palette;
         GB_color_correction_mode_t color_correction_mode;
         double light_temperature;
+        struct GB_color_table_s *color_tables[2]; // Game and border
         bool keys[4][GB_KEY_MAX];
         bool use_faux_analog[4];
         struct {
@@ -699,6 +707,17 @@ struct GB_gameboy_internal_s {
         uint64_t last_sync;
         uint64_t last_render;
         uint64_t cycles_since_last_sync; // In 8MHz units
+        struct {
+            unsigned max_skipped_frames; // 0 if disabled
+            unsigned level; // Frames skipped after every rendered frame
+            unsigned countdown;
+            unsigned calm_frames;
+            unsigned measured_frames;
+            int64_t measured_nanoseconds; // Host time spent emulating, excluding sleeps
+            int64_t slept_nanoseconds;
+            int64_t frame_start;
+            bool skipping; // disable_rendering was set by the frame skipper
+        } adaptive_frameskip;
         GB_rtc_mode_t rtc_mode;
         uint32_t rtc_second_length;
         uint32_t clock_rate;
@@ -707,6 +726,8 @@ struct GB_gameboy_internal_s {
 
         /* Audio */
         GB_apu_output_t apu_output;
+        GB_vgm_logger_t *vgm_logger;
+        GB_vgm_player_t *vgm_player;
 
         /* Callbacks */
         void *user_data;
@@ -736,6 +757,7 @@ struct GB_gameboy_internal_s {
         GB_execution_callback_t execution_callback;
         GB_lcd_line_callback_t lcd_line_callback;
         GB_lcd_status_callback_t lcd_status_callback;
+        GB_audio_sync_callback_t audio_sync_callback;
                
 #ifndef GB_DISABLE_DEBUGGER
         /*** Debugger ***/
@@ -804,15 +826,26 @@ struct GB_gameboy_internal_s {
             unsigned pos;
         } *rewind_sequences; // lasts about 4 seconds
         size_t rewind_pos;
+        size_t rewind_sequence_count; // Live sequences, ending at rewind_pos
+        size_t rewind_slots; // Length of rewind_sequences, capped by the memory limit
         bool rewind_disable_invalidation;
+        size_t rewind_memory_limit; // 0 to derive it from the rewind length
+        void *rewind_memory; // Everything below lives in this single allocation
+        size_t rewind_memory_size;
+        uint8_t *rewind_state_buffer; // Owned by the emulation thread
+        uint8_t *rewind_spare_state_buffer; // Swapped with rewind_state_buffer when handed to the worker
+        uint8_t *rewind_compression_buffer; // Sized for the worst case
+        uint8_t *rewind_arena; // Ring of key states and compressed states, oldest first
+        size_t rewind_arena_size;
+        size_t rewind_arena_head, rewind_arena_tail, rewind_arena_end; // Offsets; end marks where the ring wrapped
+        GB_rewind_worker_t *rewind_worker;
+        uint32_t rewind_instruction_count; // Instructions since the newest state was pushed
 #endif
                
         /* SGB - saved and allocated optionally */
         GB_sgb_t *sgb;
-        
-        double sgb_intro_jingle_phases[7];
-        double sgb_intro_sweep_phase;
-        double sgb_intro_sweep_previous_sample;
+        GB_sgb_border_cache_t *sgb_border_cache; // Allocated on first use
+        bool sgb_jingle_user; // Holds a reference to the shared SGB jingles
                
 #ifndef GB_DISABLE_CHEATS
        /* Cheats */
@@ -834,6 +867,13 @@ struct GB_gameboy_internal_s {
         double turbo_cap_multiplier;
         bool enable_skipped_frame_vblank_callbacks;
         bool disable_rendering;
+        bool audio_only;
+        GB_mode3_timing_t mode3_timing_cache[GB_MODE3_TIMING_CACHE_SIZE];
+        GB_mode3_timing_t pending_mode3_timing;
+        bool mode3_timing_cacheable;
+        uint16_t mode3_start_cycles;
+        uint32_t vram_block_version[0x4000 / 0x10]; // For incremental VRAM viewers
+        uint32_t vram_version;
         uint8_t boot_rom[0x900];
         bool vblank_just_occured; // For slow operations involving syscalls; these should only run once per vblank
         unsigned cycles_since_run; // How many cycles have passed since the last call to GB_run(), in 8MHz units
@@ -955,6 +995,16 @@ int GB_load_battery(GB_gameboy_t *gb, const char *path);
 void GB_set_turbo_mode(GB_gameboy_t *gb, bool on, bool no_frame_skip);
 void GB_set_turbo_cap(GB_gameboy_t *gb, double multiplier); // Use 0 to use no cap
 void GB_set_rendering_disabled(GB_gameboy_t *gb, bool disabled);
+/* Skips rendering of up to max_skipped_frames frames in a row when the host can't keep up with real time, use 0 to
+   disable. Skipped frames are reported as GB_VBLANK_TYPE_SKIPPED_FRAME if enabled. */
+void GB_set_adaptive_frameskip(GB_gameboy_t *gb, unsigned max_skipped_frames);
+/* Paces emulation with the audio device instead of the wall clock. Instead of sleeping, emulation flushes the sample
+   buffer and calls the callback, which should block until the host's audio queue has room. Returning false falls back
+   to sleeping, such as when audio is paused. Not used in turbo mode. Use NULL to disable. */
+void GB_set_audio_sync_callback(GB_gameboy_t *gb, GB_audio_sync_callback_t callback);
+/* Replaces the PPU with a line-granular model that only maintains LY, STAT and the VBlank interrupt, and disables
+   rendering. Meant for headless audio rendering of GBS files and ROMs; restarts the current frame when toggled. */
+void GB_set_audio_only_mode(GB_gameboy_t *gb, bool enabled);
     
 void GB_log(GB_gameboy_t *gb, const char *fmt, ...) __printflike(2, 3);
 void GB_attributed_log(GB_gameboy_t *gb, GB_log_attributes_t attributes, const char *fmt, ...) __printflike(3, 4);
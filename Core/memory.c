@@ -1015,7 +1015,9 @@ static void write_vram(GB_gameboy_t *gb, uint16_t addr, uint8_t value)
         //GB_log(gb, "Wrote %02x to %04x (VRAM) during mode 3\n", value, addr);
         return;
     }
-    gb->vram[(addr & 0x1FFF) + (gb->cgb_vram_bank? 0x2000 : 0)] = value;
+    addr = (addr & 0x1FFF) + (gb->cgb_vram_bank? 0x2000 : 0);
+    gb->vram[addr] = value;
+    GB_vram_written(gb, addr);
 }
 
 static bool huc3_write(GB_gameboy_t *gb, uint8_t value)
@@ -1935,9 +1937,11 @@ void GB_hdma_run(GB_gameboy_t *gb)
         if (gb->addr_for_hdma_conflict == 0xFFFF /* || ((gb->model & ~GB_MODEL_GBP_BIT) >= GB_MODEL_AGB_B && gb->cgb_double_speed) */) {
             uint16_t addr = (gb->hdma_current_dest++ & 0x1FFF);
             gb->vram[vram_base + addr] = byte;
+            GB_vram_written(gb, vram_base + addr);
             // TODO: vram_write_blocked might not be the correct timing
             if (gb->vram_write_blocked /* && (gb->model & ~GB_MODEL_GBP_BIT) < GB_MODEL_AGB_B */) {
                 gb->vram[(vram_base ^ 0x2000) + addr] = byte;
+                GB_vram_written(gb, (vram_base ^ 0x2000) + addr);
             }
         }
         else {
@@ -1949,9 +1953,11 @@ void GB_hdma_run(GB_gameboy_t *gb)
                 // TODO: there are *some* scenarions in single speed mode where this write doesn't happen. What's the logic?
                 uint16_t addr = (gb->hdma_current_dest & gb->addr_for_hdma_conflict & 0x1FFF);
                 gb->vram[vram_base + addr] = byte;
+                GB_vram_written(gb, vram_base + addr);
                 // TODO: vram_write_blocked might not be the correct timing
                 if (gb->vram_write_blocked /* && (gb->model & ~GB_MODEL_GBP_BIT) < GB_MODEL_AGB_B */) {
                     gb->vram[(vram_base ^ 0x2000) + addr] = byte;
+                    GB_vram_written(gb, (vram_base ^ 0x2000) + addr);
                 }
             }
             gb->hdma_current_dest++;
@@ -5,212 +5,417 @@
 #include <math.h>
 #include <assert.h>
 #include <string.h>
+#ifndef GB_DISABLE_THREADS
+#include <pthread.h>
+#endif
 
-static uint8_t *state_compress(const uint8_t *prev, const uint8_t *data, size_t uncompressed_size)
+/* Delta format: pairs of little endian 16-bit word counts, the first counting 32-bit words that match the key state
+   and the second counting changed words, followed by the changed words. The bytes that don't fill a word are stored
+   as-is at the end. */
+#define COMPRESSED_SIZE_BOUND(size) ((size) / 2 * 3 + 64) // Worst case is every other word changing
+
+typedef uint8_t block_t __attribute__((vector_size(16), aligned(1), may_alias));
+typedef uint64_t block_lanes_t __attribute__((vector_size(16)));
+
+static inline bool blocks_equal(const uint8_t *a, const uint8_t *b)
+{
+    block_lanes_t diff = (block_lanes_t)(*(const block_t *)a ^ *(const block_t *)b);
+    return !(diff[0] | diff[1]);
+}
+
+static inline bool words_equal(const uint8_t *a, const uint8_t *b)
+{
+    uint32_t x, y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    return x == y;
+}
+
+static inline uint8_t *write_run(uint8_t *output, size_t same, size_t changed)
+{
+    uint8_t header[4] = {same, same >> 8, changed, changed >> 8};
+    memcpy(output, header, sizeof(header));
+    return output + sizeof(header);
+}
+
+/* Returns the compressed size, output must be at least COMPRESSED_SIZE_BOUND(size) bytes */
+static size_t state_compress(const uint8_t *prev, const uint8_t *data, size_t size, uint8_t *output)
 {
-    size_t malloc_size = 0x1000;
-    uint8_t *compressed = malloc(malloc_size);
-    size_t counter_pos = 0;
-    size_t data_pos = sizeof(uint16_t);
-    bool prev_mode = true;
-    *(uint16_t *)compressed = 0;
-#define COUNTER (*(uint16_t *)&compressed[counter_pos])
-#define DATA (compressed[data_pos])
+    uint8_t *const start = output;
+    size_t words = size / 4;
+    size_t pos = 0;
     
-    while (uncompressed_size) {
-        if (prev_mode) {
-            if (*data == *prev && COUNTER != 0xFFFF) {
-                COUNTER++;
-                data++;
-                prev++;
-                uncompressed_size--;
-            }
-            else {
-                prev_mode = false;
-                counter_pos += sizeof(uint16_t);
-                data_pos = counter_pos + sizeof(uint16_t);
-                if (data_pos >= malloc_size) {
-                    malloc_size *= 2;
-                    compressed = realloc(compressed, malloc_size);
-                }
-                COUNTER = 0;
-            }
+    while (pos < words) {
+        size_t run_start = pos;
+        while (pos + 4 <= words && blocks_equal(prev + pos * 4, data + pos * 4)) {
+            pos += 4;
         }
-        else {
-            if (*data != *prev && COUNTER != 0xFFFF) {
-                COUNTER++;
-                DATA = *data;
-                data_pos++;
-                data++;
-                prev++;
-                uncompressed_size--;
-                if (data_pos >= malloc_size) {
-                    malloc_size *= 2;
-                    compressed = realloc(compressed, malloc_size);
-                }
-            }
-            else {
-                prev_mode = true;
-                counter_pos = data_pos;
-                data_pos = counter_pos + sizeof(uint16_t);
-                if (counter_pos >= malloc_size - 1) {
-                    malloc_size *= 2;
-                    compressed = realloc(compressed, malloc_size);
-                }
-                COUNTER = 0;
-            }
+        while (pos < words && words_equal(prev + pos * 4, data + pos * 4)) {
+            pos++;
+        }
+        size_t same = pos - run_start;
+        
+        run_start = pos;
+        while (pos < words && !words_equal(prev + pos * 4, data + pos * 4)) {
+            pos++;
+        }
+        size_t changed = pos - run_start;
+        
+        while (same > 0xFFFF) {
+            output = write_run(output, 0xFFFF, 0);
+            same -= 0xFFFF;
+        }
+        while (changed > 0xFFFF) {
+            output = write_run(output, same, 0xFFFF);
+            memcpy(output, data + run_start * 4, 0xFFFF * 4);
+            output += 0xFFFF * 4;
+            run_start += 0xFFFF;
+            changed -= 0xFFFF;
+            same = 0;
         }
+        output = write_run(output, same, changed);
+        memcpy(output, data + run_start * 4, changed * 4);
+        output += changed * 4;
+    }
+    
+    memcpy(output, data + words * 4, size & 3);
+    output += size & 3;
+    return output - start;
+}
+
+static void state_decompress(const uint8_t *prev, const uint8_t *data, uint8_t *dest, size_t size)
+{
+    size_t words = size / 4;
+    size_t pos = 0;
+    
+    while (pos < words) {
+        size_t same = data[0] | (data[1] << 8);
+        size_t changed = data[2] | (data[3] << 8);
+        data += 4;
+        memcpy(dest + pos * 4, prev + pos * 4, same * 4);
+        pos += same;
+        memcpy(dest + pos * 4, data, changed * 4);
+        data += changed * 4;
+        pos += changed;
     }
     
-    return  realloc(compressed, data_pos);
-#undef DATA
-#undef COUNTER
+    memcpy(dest + words * 4, data, size & 3);
 }
 
+/* Used when no memory limit is set, generous for most games' compressed states */
+#define AUTOMATIC_SEQUENCE_MEMORY(state_size) ((state_size) * 8)
 
-static void state_decompress(const uint8_t *prev, uint8_t *data, uint8_t *dest, size_t uncompressed_size)
+static bool allocate_rewind_memory(GB_gameboy_t *gb, size_t save_size)
 {
-    size_t counter_pos = 0;
-    size_t data_pos = sizeof(uint16_t);
-    bool prev_mode = true;
-#define COUNTER (*(uint16_t *)&data[counter_pos])
-#define DATA (data[data_pos])
+    const size_t sequence_size = sizeof(gb->rewind_sequences[0]);
+    const size_t scratch_size = save_size * 2 + COMPRESSED_SIZE_BOUND(save_size);
+    size_t limit = gb->rewind_memory_limit;
+    if (!limit) {
+        limit = scratch_size + gb->rewind_buffer_length * (sequence_size + AUTOMATIC_SEQUENCE_MEMORY(save_size));
+    }
+    // Every live sequence holds at least a key state
+    if (limit < scratch_size + sequence_size + save_size) return false;
+    size_t slots = MIN(gb->rewind_buffer_length, (limit - scratch_size) / (sequence_size + save_size));
     
-    while (uncompressed_size) {
-        if (prev_mode) {
-            if (COUNTER) {
-                COUNTER--;
-                *(dest++) = *(prev++);
-                uncompressed_size--;
+    uint8_t *memory = malloc(limit);
+    if (!memory) return false;
+    gb->rewind_memory = memory;
+    gb->rewind_memory_size = limit;
+    gb->rewind_sequences = (void *)memory;
+    memset(gb->rewind_sequences, 0, sequence_size * slots);
+    memory += sequence_size * slots;
+    gb->rewind_state_buffer = memory;
+    memory += save_size;
+    gb->rewind_spare_state_buffer = memory;
+    memory += save_size;
+    gb->rewind_compression_buffer = memory;
+    memory += COMPRESSED_SIZE_BOUND(save_size);
+    gb->rewind_arena = memory;
+    gb->rewind_arena_size = limit - (memory - (uint8_t *)gb->rewind_memory);
+    gb->rewind_arena_head = gb->rewind_arena_tail = gb->rewind_arena_end = 0;
+    gb->rewind_slots = slots;
+    gb->rewind_sequence_count = 0;
+    gb->rewind_pos = 0;
+    return true;
+}
+
+static void evict_oldest_sequence(GB_gameboy_t *gb)
+{
+    size_t oldest = (gb->rewind_pos + gb->rewind_slots + 1 - gb->rewind_sequence_count) % gb->rewind_slots;
+    memset(&gb->rewind_sequences[oldest], 0, sizeof(gb->rewind_sequences[oldest]));
+    if (--gb->rewind_sequence_count) {
+        // Sequences allocate their key state first, so the next one's marks the new tail
+        gb->rewind_arena_tail = gb->rewind_sequences[(oldest + 1) % gb->rewind_slots].key_state - gb->rewind_arena;
+    }
+    else {
+        gb->rewind_arena_head = gb->rewind_arena_tail = gb->rewind_arena_end = 0;
+    }
+}
+
+/* Allocates from the head of the ring, evicting the oldest sequences as long as more than keep remain */
+static uint8_t *arena_alloc(GB_gameboy_t *gb, size_t size, size_t keep)
+{
+    while (true) {
+        size_t head = gb->rewind_arena_head;
+        size_t tail = gb->rewind_arena_tail;
+        if (head >= tail) {
+            if (gb->rewind_arena_size - head >= size) {
+                gb->rewind_arena_head = head + size;
+                return gb->rewind_arena + head;
             }
-            else {
-                prev_mode = false;
-                counter_pos += sizeof(uint16_t);
-                data_pos = counter_pos + sizeof(uint16_t);
+            // Wrap around, never letting the head catch up with the tail
+            if (size < tail) {
+                gb->rewind_arena_end = head;
+                gb->rewind_arena_head = size;
+                return gb->rewind_arena;
             }
         }
-        else {
-            if (COUNTER) {
-                COUNTER--;
-                *(dest++) = DATA;
-                data_pos++;
-                prev++;
-                uncompressed_size--;
-            }
-            else {
-                prev_mode = true;
-                counter_pos = data_pos;
-                data_pos += sizeof(uint16_t);
-            }
+        else if (tail - head > size) {
+            gb->rewind_arena_head = head + size;
+            return gb->rewind_arena + head;
         }
+        if (gb->rewind_sequence_count <= keep) return NULL;
+        evict_oldest_sequence(gb);
     }
-#undef DATA
-#undef COUNTER
 }
 
-void GB_rewind_push(GB_gameboy_t *gb)
+/* Only the newest allocation can be released */
+static void arena_release(GB_gameboy_t *gb, uint8_t *allocation)
 {
-    const size_t save_size = GB_get_save_state_size_no_bess(gb);
-    if (gb->rewind_state_size != save_size) {
-        GB_rewind_reset(gb);
-        gb->rewind_state_size = save_size;
+    if (!gb->rewind_sequence_count) {
+        gb->rewind_arena_head = gb->rewind_arena_tail = gb->rewind_arena_end = 0;
+        return;
     }
-    if (!gb->rewind_sequences) {
-        if (gb->rewind_buffer_length) {
-            gb->rewind_sequences = malloc(sizeof(*gb->rewind_sequences) * gb->rewind_buffer_length);
-            memset(gb->rewind_sequences, 0, sizeof(*gb->rewind_sequences) * gb->rewind_buffer_length);
-            gb->rewind_pos = 0;
-        }
-        else {
+    gb->rewind_arena_head = allocation - gb->rewind_arena;
+    if (gb->rewind_arena_head == 0 && gb->rewind_arena_tail) {
+        // Nothing is left past the wrap point
+        gb->rewind_arena_head = gb->rewind_arena_end;
+    }
+}
+
+/* Inserts a raw state into the history, on the worker thread when there is one. instruction_count is the count for
+   the newest state so far, which GB_debugger_run was incrementing since it was pushed. */
+static void insert_state(GB_gameboy_t *gb, const uint8_t *state, uint32_t instruction_count)
+{
+    const size_t save_size = gb->rewind_state_size;
+    typeof(gb->rewind_sequences[0]) *sequence = &gb->rewind_sequences[gb->rewind_pos];
+    if (sequence->key_state) {
+        sequence->instruction_count[sequence->pos] = instruction_count;
+    }
+    if (sequence->key_state && sequence->pos < GB_REWIND_FRAMES_PER_KEY) {
+        size_t compressed_size = state_compress(sequence->key_state, state, save_size, gb->rewind_compression_buffer);
+        uint8_t *compressed = arena_alloc(gb, compressed_size, 1);
+        if (compressed) {
+            memcpy(compressed, gb->rewind_compression_buffer, compressed_size);
+            sequence->compressed_states[sequence->pos++] = compressed;
             return;
         }
+        // Doesn't fit alongside the current sequence, start a new one instead
     }
     
-    if (gb->rewind_sequences[gb->rewind_pos].pos == GB_REWIND_FRAMES_PER_KEY) {
-        gb->rewind_pos++;
-        if (gb->rewind_pos == gb->rewind_buffer_length) {
-            gb->rewind_pos = 0;
-        }
-        if (gb->rewind_sequences[gb->rewind_pos].key_state) {
-            free(gb->rewind_sequences[gb->rewind_pos].key_state);
-            gb->rewind_sequences[gb->rewind_pos].key_state = NULL;
+    // Eviction expects rewind_pos to be the newest live sequence, so only advance after allocating
+    size_t next_pos = gb->rewind_pos;
+    if (sequence->key_state) {
+        next_pos = gb->rewind_pos + 1 == gb->rewind_slots? 0 : gb->rewind_pos + 1;
+        if (gb->rewind_sequences[next_pos].key_state) {
+            // All slots are used, this is the oldest sequence
+            evict_oldest_sequence(gb);
         }
-        for (unsigned i = 0; i < GB_REWIND_FRAMES_PER_KEY; i++) {
-            if (gb->rewind_sequences[gb->rewind_pos].compressed_states[i]) {
-                free(gb->rewind_sequences[gb->rewind_pos].compressed_states[i]);
-                gb->rewind_sequences[gb->rewind_pos].compressed_states[i] = NULL;
-            }
-        }
-        gb->rewind_sequences[gb->rewind_pos].pos = 0;
     }
     
-    if (!gb->rewind_sequences[gb->rewind_pos].key_state) {
-        gb->rewind_sequences[gb->rewind_pos].key_state = malloc(save_size);
-        gb->rewind_sequences[gb->rewind_pos].instruction_count[0] = 0;
-        GB_save_state_to_buffer_no_bess(gb, gb->rewind_sequences[gb->rewind_pos].key_state);
+    // The arena always fits a key state once everything else is evicted
+    uint8_t *key_state = arena_alloc(gb, save_size, 0);
+    gb->rewind_pos = next_pos;
+    sequence = &gb->rewind_sequences[next_pos];
+    sequence->key_state = key_state;
+    sequence->pos = 0;
+    gb->rewind_sequence_count++;
+    memcpy(key_state, state, save_size);
+}
+
+/* The emulation thread only takes a raw snapshot at VBlank, compression and insertion happen on a worker thread.
+   Everything else that touches the history waits for the worker first. Without threads (GB_DISABLE_THREADS), states
+   are inserted synchronously. */
+#ifndef GB_DISABLE_THREADS
+struct GB_rewind_worker_s {
+    GB_gameboy_t *gb;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    const uint8_t *pending; // A snapshot waiting to be inserted
+    uint32_t pending_instruction_count;
+    bool stopping;
+};
+
+static void *rewind_thread(void *context)
+{
+    GB_rewind_worker_t *worker = context;
+    pthread_mutex_lock(&worker->lock);
+    while (true) {
+        while (!worker->pending && !worker->stopping) {
+            pthread_cond_wait(&worker->cond, &worker->lock);
+        }
+        if (!worker->pending) break;
+        
+        pthread_mutex_unlock(&worker->lock);
+        insert_state(worker->gb, worker->pending, worker->pending_instruction_count);
+        pthread_mutex_lock(&worker->lock);
+        worker->pending = NULL;
+        pthread_cond_broadcast(&worker->cond);
     }
-    else {
-        uint8_t *save_state = malloc(save_size);
-        assert(gb->rewind_sequences[gb->rewind_pos].key_state);
-        GB_save_state_to_buffer_no_bess(gb, save_state);
-        gb->rewind_sequences[gb->rewind_pos].compressed_states[gb->rewind_sequences[gb->rewind_pos].pos++] =
-            state_compress(gb->rewind_sequences[gb->rewind_pos].key_state, save_state, save_size);
-        gb->rewind_sequences[gb->rewind_pos].instruction_count[gb->rewind_sequences[gb->rewind_pos].pos] = 0;
-        free(save_state);
+    pthread_mutex_unlock(&worker->lock);
+    return NULL;
+}
+
+static void start_worker(GB_gameboy_t *gb)
+{
+    GB_rewind_worker_t *worker = malloc(sizeof(*worker));
+    if (!worker) return;
+    worker->gb = gb;
+    worker->pending = NULL;
+    worker->stopping = false;
+    pthread_mutex_init(&worker->lock, NULL);
+    pthread_cond_init(&worker->cond, NULL);
+    if (pthread_create(&worker->thread, NULL, rewind_thread, worker)) {
+        pthread_mutex_destroy(&worker->lock);
+        pthread_cond_destroy(&worker->cond);
+        free(worker);
+        return;
     }
-    
+    gb->rewind_worker = worker;
 }
 
-bool GB_rewind_pop(GB_gameboy_t *gb)
+static void stop_worker(GB_gameboy_t *gb)
 {
-    GB_ASSERT_NOT_RUNNING(gb)
-    
-    if (!gb->rewind_sequences || !gb->rewind_sequences[gb->rewind_pos].key_state) {
-        return false;
+    GB_rewind_worker_t *worker = gb->rewind_worker;
+    if (!worker) return;
+    pthread_mutex_lock(&worker->lock);
+    worker->stopping = true;
+    pthread_cond_broadcast(&worker->cond);
+    pthread_mutex_unlock(&worker->lock);
+    pthread_join(worker->thread, NULL);
+    pthread_mutex_destroy(&worker->lock);
+    pthread_cond_destroy(&worker->cond);
+    free(worker);
+    gb->rewind_worker = NULL;
+}
+#endif
+
+void GB_rewind_sync(GB_gameboy_t *gb)
+{
+#ifndef GB_DISABLE_THREADS
+    GB_rewind_worker_t *worker = gb->rewind_worker;
+    if (!worker) return;
+    pthread_mutex_lock(&worker->lock);
+    while (worker->pending) {
+        pthread_cond_wait(&worker->cond, &worker->lock);
     }
-    
+    pthread_mutex_unlock(&worker->lock);
+#endif
+}
+
+void GB_rewind_push(GB_gameboy_t *gb)
+{
     const size_t save_size = GB_get_save_state_size_no_bess(gb);
-    if (gb->rewind_sequences[gb->rewind_pos].pos == 0) {
-        gb->rewind_disable_invalidation = true;
-        GB_load_state_from_buffer(gb, gb->rewind_sequences[gb->rewind_pos].key_state, save_size);
-        gb->rewind_disable_invalidation = false;
-        free(gb->rewind_sequences[gb->rewind_pos].key_state);
-        gb->rewind_sequences[gb->rewind_pos].key_state = NULL;
-        gb->rewind_pos = gb->rewind_pos == 0? gb->rewind_buffer_length - 1 : gb->rewind_pos - 1;
-        return true;
+    if (gb->rewind_state_size != save_size) {
+        GB_rewind_reset(gb);
+        gb->rewind_state_size = save_size;
+    }
+    if (!gb->rewind_memory) {
+        if (!gb->rewind_buffer_length || !allocate_rewind_memory(gb, save_size)) return;
+#ifndef GB_DISABLE_THREADS
+        start_worker(gb);
+#endif
     }
     
-    uint8_t *save_state = malloc(save_size);
-    state_decompress(gb->rewind_sequences[gb->rewind_pos].key_state,
-                     gb->rewind_sequences[gb->rewind_pos].compressed_states[--gb->rewind_sequences[gb->rewind_pos].pos],
-                     save_state,
-                     save_size);
-    free(gb->rewind_sequences[gb->rewind_pos].compressed_states[gb->rewind_sequences[gb->rewind_pos].pos]);
-    gb->rewind_sequences[gb->rewind_pos].compressed_states[gb->rewind_sequences[gb->rewind_pos].pos] = NULL;
+    uint8_t *state = gb->rewind_state_buffer;
+    GB_save_state_to_buffer_no_bess(gb, state);
+    uint32_t instruction_count = gb->rewind_instruction_count;
+    gb->rewind_instruction_count = 0;
+#ifndef GB_DISABLE_THREADS
+    GB_rewind_worker_t *worker = gb->rewind_worker;
+    if (worker) {
+        pthread_mutex_lock(&worker->lock);
+        // Only blocks if the previous frame's state is still being compressed
+        while (worker->pending) {
+            pthread_cond_wait(&worker->cond, &worker->lock);
+        }
+        worker->pending = state;
+        worker->pending_instruction_count = instruction_count;
+        pthread_cond_broadcast(&worker->cond);
+        pthread_mutex_unlock(&worker->lock);
+        gb->rewind_state_buffer = gb->rewind_spare_state_buffer;
+        gb->rewind_spare_state_buffer = state;
+        return;
+    }
+#endif
+    insert_state(gb, state, instruction_count);
+}
+
+static void load_rewind_state(GB_gameboy_t *gb, const uint8_t *state)
+{
     gb->rewind_disable_invalidation = true;
-    GB_load_state_from_buffer(gb, save_state, save_size);
+    GB_load_state_from_buffer(gb, state, gb->rewind_state_size);
     gb->rewind_disable_invalidation = false;
-    free(save_state);
-    return true;
 }
 
-void GB_rewind_reset(GB_gameboy_t *gb)
+unsigned GB_rewind_seek(GB_gameboy_t *gb, unsigned frames)
 {
-    GB_ASSERT_NOT_RUNNING_OTHER_THREAD(gb)
+    GB_ASSERT_NOT_RUNNING(gb)
+    GB_rewind_sync(gb);
+    
+    if (!gb->rewind_sequences) return 0;
     
-    if (!gb->rewind_sequences) return;
-    for (unsigned i = 0; i < gb->rewind_buffer_length; i++) {
-        if (gb->rewind_sequences[i].key_state) {
-            free(gb->rewind_sequences[i].key_state);
+    unsigned remaining = frames;
+    while (remaining) {
+        typeof(gb->rewind_sequences[0]) *sequence = &gb->rewind_sequences[gb->rewind_pos];
+        if (!sequence->key_state) break;
+        
+        if (remaining <= sequence->pos) {
+            // The target is a compressed state in this sequence, release it and everything after it at once
+            sequence->pos -= remaining;
+            uint8_t *compressed = sequence->compressed_states[sequence->pos];
+            state_decompress(sequence->key_state, compressed, gb->rewind_state_buffer, gb->rewind_state_size);
+            arena_release(gb, compressed);
+            memset(&sequence->compressed_states[sequence->pos], 0, remaining * sizeof(sequence->compressed_states[0]));
+            gb->rewind_instruction_count = sequence->instruction_count[sequence->pos];
+            load_rewind_state(gb, gb->rewind_state_buffer);
+            return frames;
         }
-        for (unsigned j = 0; j < GB_REWIND_FRAMES_PER_KEY; j++) {
-            if (gb->rewind_sequences[i].compressed_states[j]) {
-                free(gb->rewind_sequences[i].compressed_states[j]);
-            }
+        
+        // Drop the entire sequence, loading its key state if it's the target or the oldest state left
+        remaining -= sequence->pos + 1;
+        if (!remaining || gb->rewind_sequence_count == 1) {
+            load_rewind_state(gb, sequence->key_state);
         }
+        gb->rewind_sequence_count--;
+        arena_release(gb, sequence->key_state);
+        memset(sequence, 0, sizeof(*sequence));
+        gb->rewind_pos = gb->rewind_pos == 0? gb->rewind_slots - 1 : gb->rewind_pos - 1;
+        sequence = &gb->rewind_sequences[gb->rewind_pos];
+        gb->rewind_instruction_count = sequence->key_state? sequence->instruction_count[sequence->pos] : 0;
     }
-    free(gb->rewind_sequences);
+    return frames - remaining;
+}
+
+bool GB_rewind_pop(GB_gameboy_t *gb)
+{
+    return GB_rewind_seek(gb, 1);
+}
+
+void GB_rewind_reset(GB_gameboy_t *gb)
+{
+    GB_ASSERT_NOT_RUNNING_OTHER_THREAD(gb)
+    
+    if (!gb->rewind_memory) return;
+#ifndef GB_DISABLE_THREADS
+    stop_worker(gb);
+#endif
+    free(gb->rewind_memory);
+    gb->rewind_memory = NULL;
+    gb->rewind_memory_size = 0;
     gb->rewind_sequences = NULL;
+    gb->rewind_sequence_count = 0;
 }
 
 void GB_set_rewind_length(GB_gameboy_t *gb, double seconds)
@@ -224,11 +429,29 @@ void GB_set_rewind_length(GB_gameboy_t *gb, double seconds)
     }
 }
 
+void GB_set_rewind_memory_limit(GB_gameboy_t *gb, size_t bytes)
+{
+    GB_rewind_reset(gb);
+    gb->rewind_memory_limit = bytes;
+}
+
+size_t GB_get_rewind_memory_size(GB_gameboy_t *gb)
+{
+    return gb->rewind_memory_size;
+}
+
+size_t GB_get_rewind_memory_usage(GB_gameboy_t *gb)
+{
+    if (!gb->rewind_memory) return 0;
+    GB_rewind_sync(gb);
+    if (gb->rewind_arena_head >= gb->rewind_arena_tail) {
+        return gb->rewind_arena_head - gb->rewind_arena_tail;
+    }
+    return gb->rewind_arena_end - gb->rewind_arena_tail + gb->rewind_arena_head;
+}
+
 void GB_rewind_invalidate_for_backstepping(GB_gameboy_t *gb)
 {
     if (gb->rewind_disable_invalidation) return;
-    if (gb->rewind_sequences && gb->rewind_sequences[gb->rewind_pos].key_state) {
-        typeof(gb->rewind_sequences[0]) *sequence = &gb->rewind_sequences[gb->rewind_pos];
-        sequence->instruction_count[sequence->pos] |= 0x80000000;
-    }
+    gb->rewind_instruction_count |= 0x80000000;
 }
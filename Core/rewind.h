@@ -2,13 +2,25 @@
 
 #ifndef GB_DISABLE_REWIND
 #include <stdbool.h>
+#include <stddef.h>
 #include "defs.h"
 
+typedef struct GB_rewind_worker_s GB_rewind_worker_t;
+
 #ifdef GB_INTERNAL
 internal void GB_rewind_push(GB_gameboy_t *gb);
+internal void GB_rewind_sync(GB_gameboy_t *gb); // Waits for pushed states to be inserted
 internal void GB_rewind_invalidate_for_backstepping(GB_gameboy_t *gb);
 #endif
 bool GB_rewind_pop(GB_gameboy_t *gb);
+/* Rewinds up to frames frames at the cost of a single pop, returns how many frames were rewound */
+unsigned GB_rewind_seek(GB_gameboy_t *gb, unsigned frames);
 void GB_set_rewind_length(GB_gameboy_t *gb, double seconds);
 void GB_rewind_reset(GB_gameboy_t *gb);
+
+/* Caps the memory used by rewinding, which is allocated once on the first frame. When the cap is reached the oldest
+   history is dropped, so the rewind length becomes an upper bound. 0 picks a cap from the rewind length. */
+void GB_set_rewind_memory_limit(GB_gameboy_t *gb, size_t bytes);
+size_t GB_get_rewind_memory_size(GB_gameboy_t *gb); // The allocated size, including scratch buffers
+size_t GB_get_rewind_memory_usage(GB_gameboy_t *gb); // Bytes of history currently stored
 #endif
@@ -373,6 +373,8 @@ static bool verify_and_update_state_compatibility(GB_gameboy_t *gb, GB_gameboy_t
 
 static void sanitize_state(GB_gameboy_t *gb)
 {
+    gb->mode3_timing_cacheable = false;
+    GB_mark_vram_dirty(gb);
     for (unsigned i = 0; i < 32; i++) {
         GB_palette_changed(gb, false, i * 2);
         GB_palette_changed(gb, true, i * 2);
@@ -1269,6 +1271,8 @@ done:
     else {
         GB_log(gb, "Save state imported from another emulator.\n"); // SameBoy always contains a NAME block
     }
+    gb->mode3_timing_cacheable = false;
+    GB_mark_vram_dirty(gb);
     for (unsigned i = 0; i < 32; i++) {
         GB_palette_changed(gb, false, i * 2);
         GB_palette_changed(gb, true, i * 2);
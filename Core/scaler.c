@@ -0,0 +1,818 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "gb.h"
+#ifndef GB_DISABLE_THREADS
+#include <pthread.h>
+#endif
+
+/* Like Shaders/MasterShader.fsh, filters sample colors in linear light and convert back when writing the output.
+   Pixel math uses vector extensions, which map to SSE/NEON where available. */
+
+#define GAMMA 2.2
+#define MAX_THREADS 16
+#define MIN_PIXELS_PER_THREAD 0x10000
+
+typedef float vec4 __attribute__((vector_size(16)));
+typedef uint32_t pixel4 __attribute__((vector_size(16)));
+
+/* Converting back is looked up by the float's exponent and top mantissa bits. Each such bucket is narrow enough to
+   contain at most one rounding threshold, so the guess is off by at most one. */
+#define OUTPUT_MIN_EXPONENT 20 // Anything under 2^-20 is 0
+#define OUTPUT_BUCKET_BITS 8
+
+static float linear_table[256];
+static float output_thresholds[257]; // output_thresholds[n] is the smallest linear value that rounds to n
+static uint8_t output_guesses[OUTPUT_MIN_EXPONENT << OUTPUT_BUCKET_BITS];
+static bool tables_ready = false;
+
+static inline unsigned output_bucket(float x)
+{
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (bits >> (23 - OUTPUT_BUCKET_BITS)) - ((127 - OUTPUT_MIN_EXPONENT) << OUTPUT_BUCKET_BITS);
+}
+
+static void build_tables(void)
+{
+    if (__atomic_load_n(&tables_ready, __ATOMIC_ACQUIRE)) return;
+    for (unsigned i = 0; i < 256; i++) {
+        linear_table[i] = pow(i / 255.0, GAMMA);
+    }
+    output_thresholds[0] = 0;
+    for (unsigned i = 1; i < 256; i++) {
+        output_thresholds[i] = pow((i - 0.5) / 255.0, GAMMA);
+    }
+    output_thresholds[256] = 2;
+    for (unsigned i = 0; i < sizeof(output_guesses); i++) {
+        uint32_t bits = (i + ((127 - OUTPUT_MIN_EXPONENT) << OUTPUT_BUCKET_BITS)) << (23 - OUTPUT_BUCKET_BITS);
+        float start;
+        memcpy(&start, &bits, sizeof(start));
+        unsigned guess = 0;
+        while (start >= output_thresholds[guess + 1]) guess++;
+        output_guesses[i] = guess;
+    }
+    // Concurrent builders write identical values, so publishing twice is harmless
+    __atomic_store_n(&tables_ready, true, __ATOMIC_RELEASE);
+}
+
+static inline uint8_t output_channel(float x)
+{
+    if (!(x >= 1.0f / (1 << OUTPUT_MIN_EXPONENT))) return 0;
+    if (x >= 1) return 255;
+    unsigned ret = output_guesses[output_bucket(x)];
+    return ret + (x >= output_thresholds[ret + 1]);
+}
+
+typedef struct {
+    unsigned shifts[4]; // Red, green, blue, alpha
+} channel_layout_t;
+
+static inline vec4 to_linear(uint32_t pixel, const channel_layout_t *layout)
+{
+    return (vec4){
+        linear_table[(pixel >> layout->shifts[0]) & 0xFF],
+        linear_table[(pixel >> layout->shifts[1]) & 0xFF],
+        linear_table[(pixel >> layout->shifts[2]) & 0xFF],
+        linear_table[(pixel >> layout->shifts[3]) & 0xFF],
+    };
+}
+
+static inline uint32_t from_linear(vec4 color, const channel_layout_t *layout)
+{
+    return ((uint32_t)output_channel(color[0]) << layout->shifts[0]) |
+           ((uint32_t)output_channel(color[1]) << layout->shifts[1]) |
+           ((uint32_t)output_channel(color[2]) << layout->shifts[2]) |
+           ((uint32_t)output_channel(color[3]) << layout->shifts[3]);
+}
+
+static inline vec4 mix(vec4 x, vec4 y, float a)
+{
+    return x * (1 - a) + y * a;
+}
+
+/* The colorspace used by the HQnx filters and OmniScale, see Shaders/HQ2x.fsh */
+static inline vec4 rgb_to_hq_colorspace(vec4 rgb)
+{
+    return (vec4){
+         0.250f * rgb[0] + 0.250f * rgb[1] + 0.250f * rgb[2],
+         0.250f * rgb[0] - 0.000f * rgb[1] - 0.250f * rgb[2],
+        -0.125f * rgb[0] + 0.250f * rgb[1] - 0.125f * rgb[2],
+        0,
+    };
+}
+
+typedef int32_t int4 __attribute__((vector_size(16)));
+
+static inline bool is_different(vec4 a, vec4 b)
+{
+    vec4 diff = (vec4)((int4)(a - b) & 0x7FFFFFFF);
+    int4 different = diff > (vec4){0.018f, 0.002f, 0.005f, 1.0f};
+    return different[0] | different[1] | different[2];
+}
+
+/* Bits of a neighbor pattern, for a quarter being the top left one:
+   0 1 2
+   3 * 4
+   5 6 7 */
+static inline uint8_t flip_pattern_horizontally(uint8_t pattern)
+{
+    return (pattern & 0x42) | ((pattern & 0x01) << 2) | ((pattern >> 2) & 0x01) |
+           ((pattern & 0x08) << 1) | ((pattern >> 1) & 0x08) | ((pattern & 0x20) << 2) | ((pattern >> 2) & 0x20);
+}
+
+static inline uint8_t flip_pattern_vertically(uint8_t pattern)
+{
+    return (pattern & 0x18) | ((pattern & 0x07) << 5) | ((pattern >> 5) & 0x07);
+}
+
+typedef struct {
+    GB_scaler_t scaler;
+    channel_layout_t layout;
+    uint32_t *dest;
+    unsigned width, height, factor;
+
+    /* Source image sampled by the quadrant based filters, which is either the input or its Scale2x output */
+    const uint32_t *image;
+    unsigned image_width, image_height;
+    /* For quadrant based filters, the output color of each quarter of each image pixel */
+    uint32_t *quadrants[4];
+    /* For each output column and row, the image pixel it samples times 2, plus 1 for the right/bottom half */
+    unsigned *columns, *rows;
+
+    /* Linear and HQ colorspace copies of the input, for HQ2x and OmniScale */
+    vec4 *linear, *hq;
+    /* Which neighbors of each pixel are different from it, plus FLAT_PIXEL if they are all identical to it */
+    uint16_t *patterns;
+} scale_context_t;
+
+#define FLAT_PIXEL 0x100
+
+typedef void band_function_t(scale_context_t *context, unsigned first_row, unsigned last_row);
+
+typedef struct {
+    band_function_t *function;
+    scale_context_t *context;
+    unsigned first_row, last_row;
+} band_t;
+
+static void *band_thread(void *arg)
+{
+    band_t *band = arg;
+    band->function(band->context, band->first_row, band->last_row);
+    return NULL;
+}
+
+/* Splits rows into equal bands, rendering one on the calling thread and the others on new threads. Creating a thread
+   costs more than a small band, so passes only split when every band gets at least MIN_PIXELS_PER_THREAD pixels. */
+static void run_bands(band_function_t *function, scale_context_t *context, unsigned rows, unsigned row_pixels,
+                      unsigned threads)
+{
+#ifdef GB_DISABLE_THREADS
+    threads = 1;
+#endif
+    if (threads > (size_t)rows * row_pixels / MIN_PIXELS_PER_THREAD) {
+        threads = (size_t)rows * row_pixels / MIN_PIXELS_PER_THREAD;
+    }
+    if (threads > rows) threads = rows;
+    if (threads <= 1) {
+        function(context, 0, rows);
+        return;
+    }
+
+#ifndef GB_DISABLE_THREADS
+    band_t bands[MAX_THREADS];
+    pthread_t thread_ids[MAX_THREADS];
+    bool started[MAX_THREADS] = {false,};
+    for (unsigned i = 0; i < threads; i++) {
+        bands[i] = (band_t){function, context, rows * i / threads, rows * (i + 1) / threads};
+    }
+    for (unsigned i = 1; i < threads; i++) {
+        started[i] = pthread_create(&thread_ids[i], NULL, band_thread, &bands[i]) == 0;
+    }
+    band_thread(&bands[0]);
+    for (unsigned i = 1; i < threads; i++) {
+        if (started[i]) {
+            pthread_join(thread_ids[i], NULL);
+        }
+        else {
+            band_thread(&bands[i]);
+        }
+    }
+#endif
+}
+
+static inline unsigned clamp_coordinate(signed value, unsigned size)
+{
+    if (value < 0) return 0;
+    if (value >= (signed)size) return size - 1;
+    return value;
+}
+
+/* Scale2x, see Shaders/Scale2x.fsh. B and H are the pixels above and below E, D and F are to its left and right. */
+
+static inline void scale2x_pixel(uint32_t B, uint32_t D, uint32_t E, uint32_t F, uint32_t H, uint32_t out[4])
+{
+    out[0] = D == B && B != F && D != H ? D : E;
+    out[1] = B == F && B != D && F != H ? F : E;
+    out[2] = D == H && D != B && H != F ? D : E;
+    out[3] = H == F && D != H && B != F ? F : E;
+}
+
+static inline pixel4 load_pixels(const uint32_t *pixels)
+{
+    pixel4 ret;
+    memcpy(&ret, pixels, sizeof(ret));
+    return ret;
+}
+
+static inline void store_pixels(uint32_t *dest, pixel4 pixels)
+{
+    memcpy(dest, &pixels, sizeof(pixels));
+}
+
+static inline pixel4 select_pixels(pixel4 mask, pixel4 a, pixel4 b)
+{
+    return (a & mask) | (b & ~mask);
+}
+
+static void scale2x_band(scale_context_t *context, unsigned first_row, unsigned last_row)
+{
+    const uint32_t *image = context->image;
+    unsigned width = context->image_width;
+    unsigned height = context->image_height;
+
+    for (unsigned y = first_row; y < last_row; y++) {
+        const uint32_t *above = image + clamp_coordinate(y - 1, height) * width;
+        const uint32_t *row = image + y * width;
+        const uint32_t *below = image + clamp_coordinate(y + 1, height) * width;
+        uint32_t *out[4];
+        for (unsigned i = 0; i < 4; i++) {
+            out[i] = context->quadrants[i] + y * width;
+        }
+
+        unsigned x = 0;
+        // The edges clamp, everything else is done 4 pixels at a time
+        for (; x < width; x++) {
+            if (x != 0 && x + 4 < width) break;
+            uint32_t quadrants[4];
+            scale2x_pixel(above[x], row[clamp_coordinate(x - 1, width)], row[x],
+                          row[clamp_coordinate(x + 1, width)], below[x], quadrants);
+            for (unsigned i = 0; i < 4; i++) {
+                out[i][x] = quadrants[i];
+            }
+        }
+        for (; x + 4 < width; x += 4) {
+            pixel4 B = load_pixels(above + x);
+            pixel4 D = load_pixels(row + x - 1);
+            pixel4 E = load_pixels(row + x);
+            pixel4 F = load_pixels(row + x + 1);
+            pixel4 H = load_pixels(below + x);
+
+            pixel4 DB = (pixel4)(D == B), BF = (pixel4)(B != F), DH = (pixel4)(D != H);
+            pixel4 HF = (pixel4)(H == F);
+            store_pixels(out[0] + x, select_pixels(DB & BF & DH, D, E));
+            store_pixels(out[1] + x, select_pixels(~BF & ~DB & ~HF, F, E)); // B == F && B != D && F != H
+            store_pixels(out[2] + x, select_pixels(~DH & ~DB & ~HF, D, E)); // D == H && D != B && H != F
+            store_pixels(out[3] + x, select_pixels(HF & DH & BF, F, E));
+        }
+        for (; x < width; x++) {
+            uint32_t quadrants[4];
+            scale2x_pixel(above[x], row[x - 1], row[x], row[clamp_coordinate(x + 1, width)], below[x], quadrants);
+            for (unsigned i = 0; i < 4; i++) {
+                out[i][x] = quadrants[i];
+            }
+        }
+    }
+}
+
+/* The anti-aliased variants mix the Scale2x output evenly with the original pixel */
+static void anti_alias_band(scale_context_t *context, unsigned first_row, unsigned last_row)
+{
+    unsigned width = context->image_width;
+    for (unsigned y = first_row; y < last_row; y++) {
+        for (unsigned x = 0; x < width; x++) {
+            uint32_t E = context->image[y * width + x];
+            for (unsigned i = 0; i < 4; i++) {
+                uint32_t *pixel = &context->quadrants[i][y * width + x];
+                if (*pixel == E) continue;
+                *pixel = from_linear(mix(to_linear(*pixel, &context->layout), to_linear(E, &context->layout), 0.5f),
+                                     &context->layout);
+            }
+        }
+    }
+}
+
+/* HQ2x, see Shaders/HQ2x.fsh. Each quarter only depends on its 3x3 neighborhood, flipped so the quarter is always
+   the top left one. */
+
+#define P(m, r) ((pattern & (m)) == (r))
+
+static inline vec4 interp_2px(vec4 c1, float w1, vec4 c2, float w2)
+{
+    return (c1 * w1 + c2 * w2) / (w1 + w2);
+}
+
+static inline vec4 interp_3px(vec4 c1, float w1, vec4 c2, float w2, vec4 c3, float w3)
+{
+    return (c1 * w1 + c2 * w2 + c3 * w3) / (w1 + w2 + w3);
+}
+
+static vec4 hq2x_quadrant(scale_context_t *context, unsigned x, unsigned y, signed ox, signed oy)
+{
+    unsigned width = context->width;
+    unsigned height = context->height;
+    unsigned left = clamp_coordinate(x - ox, width), right = clamp_coordinate(x + ox, width);
+    unsigned up = clamp_coordinate(y - oy, height) * width, down = clamp_coordinate(y + oy, height) * width;
+    unsigned middle = y * width;
+
+    const vec4 *w = context->linear, *hq = context->hq;
+    vec4 w0 = w[up + left], w1 = w[up + x], w3 = w[middle + left], w4 = w[middle + x];
+
+    uint8_t pattern = context->patterns[middle + x];
+    if (ox < 0) pattern = flip_pattern_horizontally(pattern);
+    if (oy < 0) pattern = flip_pattern_vertically(pattern);
+
+    vec4 h1 = hq[up + x], h3 = hq[middle + left], h5 = hq[middle + right], h7 = hq[down + x];
+
+    if ((P(0xBF,0x37) || P(0xDB,0x13)) && is_different(h1, h5)) {
+        return interp_2px(w4, 3.0, w3, 1.0);
+    }
+    if ((P(0xDB,0x49) || P(0xEF,0x6D)) && is_different(h7, h3)) {
+        return interp_2px(w4, 3.0, w1, 1.0);
+    }
+    if ((P(0x0B,0x0B) || P(0xFE,0x4A) || P(0xFE,0x1A)) && is_different(h3, h1)) {
+        return w4;
+    }
+    if ((P(0x6F,0x2A) || P(0x5B,0x0A) || P(0xBF,0x3A) || P(0xDF,0x5A) ||
+         P(0x9F,0x8A) || P(0xCF,0x8A) || P(0xEF,0x4E) || P(0x3F,0x0E) ||
+         P(0xFB,0x5A) || P(0xBB,0x8A) || P(0x7F,0x5A) || P(0xAF,0x8A) ||
+         P(0xEB,0x8A)) && is_different(h3, h1)) {
+        return interp_2px(w4, 3.0, w0, 1.0);
+    }
+    if (P(0x0B,0x08)) {
+        return interp_3px(w4, 2.0, w0, 1.0, w1, 1.0);
+    }
+    if (P(0x0B,0x02)) {
+        return interp_3px(w4, 2.0, w0, 1.0, w3, 1.0);
+    }
+    if (P(0x2F,0x2F)) {
+        return interp_3px(w4, 4.0, w3, 1.0, w1, 1.0);
+    }
+    if (P(0xBF,0x37) || P(0xDB,0x13)) {
+        return interp_3px(w4, 5.0, w1, 2.0, w3, 1.0);
+    }
+    if (P(0xDB,0x49) || P(0xEF,0x6D)) {
+        return interp_3px(w4, 5.0, w3, 2.0, w1, 1.0);
+    }
+    if (P(0x1B,0x03) || P(0x4F,0x43) || P(0x8B,0x83) || P(0x6B,0x43)) {
+        return interp_2px(w4, 3.0, w3, 1.0);
+    }
+    if (P(0x4B,0x09) || P(0x8B,0x89) || P(0x1F,0x19) || P(0x3B,0x19)) {
+        return interp_2px(w4, 3.0, w1, 1.0);
+    }
+    if (P(0x7E,0x2A) || P(0xEF,0xAB) || P(0xBF,0x8F) || P(0x7E,0x0E)) {
+        return interp_3px(w4, 2.0, w3, 3.0, w1, 3.0);
+    }
+    if (P(0xFB,0x6A) || P(0x6F,0x6E) || P(0x3F,0x3E) || P(0xFB,0xFA) ||
+        P(0xDF,0xDE) || P(0xDF,0x1E)) {
+        return interp_2px(w4, 3.0, w0, 1.0);
+    }
+    if (P(0x0A,0x00) || P(0x4F,0x4B) || P(0x9F,0x1B) || P(0x2F,0x0B) ||
+        P(0xBE,0x0A) || P(0xEE,0x0A) || P(0x7E,0x0A) || P(0xEB,0x4B) ||
+        P(0x3B,0x1B)) {
+        return interp_3px(w4, 2.0, w3, 1.0, w1, 1.0);
+    }
+
+    return interp_3px(w4, 6.0, w3, 1.0, w1, 1.0);
+}
+
+static void hq2x_band(scale_context_t *context, unsigned first_row, unsigned last_row)
+{
+    unsigned width = context->width;
+    for (unsigned y = first_row; y < last_row; y++) {
+        for (unsigned x = 0; x < width; x++) {
+            unsigned index = y * width + x;
+            if (context->patterns[index] & FLAT_PIXEL) {
+                for (unsigned i = 0; i < 4; i++) {
+                    context->quadrants[i][index] = context->image[index];
+                }
+                continue;
+            }
+            context->quadrants[0][index] = from_linear(hq2x_quadrant(context, x, y,  1,  1), &context->layout);
+            context->quadrants[1][index] = from_linear(hq2x_quadrant(context, x, y, -1,  1), &context->layout);
+            context->quadrants[2][index] = from_linear(hq2x_quadrant(context, x, y,  1, -1), &context->layout);
+            context->quadrants[3][index] = from_linear(hq2x_quadrant(context, x, y, -1, -1), &context->layout);
+        }
+    }
+}
+
+/* Writes the output of a quadrant based filter, each output pixel takes the quarter its center falls in */
+static void expand_quadrants_band(scale_context_t *context, unsigned first_row, unsigned last_row)
+{
+    unsigned output_width = context->width * context->factor;
+    for (unsigned y = first_row; y < last_row; y++) {
+        unsigned row = context->rows[y];
+        unsigned offset = (row >> 1) * context->image_width;
+        const uint32_t *left = context->quadrants[(row & 1) * 2] + offset;
+        const uint32_t *right = context->quadrants[(row & 1) * 2 + 1] + offset;
+        uint32_t *dest = context->dest + y * output_width;
+        for (unsigned x = 0; x < output_width; x++) {
+            unsigned column = context->columns[x];
+            dest[x] = ((column & 1)? right : left)[column >> 1];
+        }
+    }
+}
+
+/* OmniScale, see Shaders/OmniScale.fsh. Unlike the other filters, the output depends on the exact position within
+   each pixel. */
+
+static vec4 omniscale_pixel(scale_context_t *context, unsigned x, unsigned y, float px, float py)
+{
+    unsigned width = context->width;
+    unsigned height = context->height;
+    signed ox = 1, oy = 1;
+    if (px > 0.5f) {
+        ox = -ox;
+        px = 1.0f - px;
+    }
+    if (py > 0.5f) {
+        oy = -oy;
+        py = 1.0f - py;
+    }
+
+    const vec4 *w = context->linear, *hq = context->hq;
+    #define SAMPLE(array, dx, dy) array[clamp_coordinate((signed)y + (dy), height) * width + \
+                                        clamp_coordinate((signed)x + (dx), width)]
+    vec4 w0 = SAMPLE(w, -ox, -oy), w1 = SAMPLE(w, 0, -oy);
+    vec4 w3 = SAMPLE(w, -ox,   0), w4 = SAMPLE(w, 0,   0);
+    vec4 h0 = SAMPLE(hq, -ox, -oy), h1 = SAMPLE(hq, 0, -oy), h3 = SAMPLE(hq, -ox, 0), h4 = SAMPLE(hq, 0, 0);
+    vec4 h5 = SAMPLE(hq, ox, 0), h7 = SAMPLE(hq, 0, oy);
+
+    unsigned pattern = context->patterns[y * width + x] & 0xFF;
+    if (ox < 0) pattern = flip_pattern_horizontally(pattern);
+    if (oy < 0) pattern = flip_pattern_vertically(pattern);
+
+    float pixel_size = sqrtf(2.0f) / context->factor;
+
+    if ((P(0xBF,0x37) || P(0xDB,0x13)) && is_different(h1, h5)) {
+        return mix(w4, w3, 0.5f - px);
+    }
+    if ((P(0xDB,0x49) || P(0xEF,0x6D)) && is_different(h7, h3)) {
+        return mix(w4, w1, 0.5f - py);
+    }
+    if ((P(0x0B,0x0B) || P(0xFE,0x4A) || P(0xFE,0x1A)) && is_different(h3, h1)) {
+        return w4;
+    }
+    if ((P(0x6F,0x2A) || P(0x5B,0x0A) || P(0xBF,0x3A) || P(0xDF,0x5A) ||
+         P(0x9F,0x8A) || P(0xCF,0x8A) || P(0xEF,0x4E) || P(0x3F,0x0E) ||
+         P(0xFB,0x5A) || P(0xBB,0x8A) || P(0x7F,0x5A) || P(0xAF,0x8A) ||
+         P(0xEB,0x8A)) && is_different(h3, h1)) {
+        return mix(w4, mix(w4, w0, 0.5f - px), 0.5f - py);
+    }
+    if (P(0x0B,0x08)) {
+        return mix(mix(w0 * 0.375f + w1 * 0.25f + w4 * 0.375f, w4 * 0.5f + w1 * 0.5f, px * 2.0f), w4, py * 2.0f);
+    }
+    if (P(0x0B,0x02)) {
+        return mix(mix(w0 * 0.375f + w3 * 0.25f + w4 * 0.375f, w4 * 0.5f + w3 * 0.5f, py * 2.0f), w4, px * 2.0f);
+    }
+
+    /* Several patterns blend w4 into the same corner interpolation along a line */
+    #define CORNER() ((is_different(h0, h1) || is_different(h0, h3))? \
+        mix(w1, w3, py - px + 0.5f) : \
+        mix(mix(w1 * 0.375f + w0 * 0.25f + w3 * 0.375f, w3, py * 2.0f), w1, px * 2.0f))
+
+    if (P(0x2F,0x2F)) {
+        float dist = sqrtf((px - 0.5f) * (px - 0.5f) + (py - 0.5f) * (py - 0.5f));
+        if (dist < 0.5f - pixel_size / 2.0f) {
+            return w4;
+        }
+        vec4 r = CORNER();
+        if (dist > 0.5f + pixel_size / 2.0f) {
+            return r;
+        }
+        return mix(w4, r, (dist - 0.5f + pixel_size / 2.0f) / pixel_size);
+    }
+    if (P(0xBF,0x37) || P(0xDB,0x13)) {
+        float dist = px - 2.0f * py;
+        float line_size = pixel_size * sqrtf(5.0f);
+        if (dist > line_size / 2.0f) {
+            return w1;
+        }
+        vec4 r = mix(w3, w4, px + 0.5f);
+        if (dist < -line_size / 2.0f) {
+            return r;
+        }
+        return mix(r, w1, (dist + line_size / 2.0f) / line_size);
+    }
+    if (P(0xDB,0x49) || P(0xEF,0x6D)) {
+        float dist = py - 2.0f * px;
+        float line_size = pixel_size * sqrtf(5.0f);
+        if (dist > line_size / 2.0f) {
+            return w3;
+        }
+        vec4 r = mix(w1, w4, px + 0.5f);
+        if (dist < -line_size / 2.0f) {
+            return r;
+        }
+        return mix(r, w3, (dist + line_size / 2.0f) / line_size);
+    }
+    if (P(0xBF,0x8F) || P(0x7E,0x0E) || P(0x7E,0x2A) || P(0xEF,0xAB)) {
+        // The shader checks these as two separate groups, mirrored along the diagonal
+        bool mirrored = P(0x7E,0x2A) || P(0xEF,0xAB);
+        if (P(0xBF,0x8F) || P(0x7E,0x0E)) {
+            mirrored = false;
+        }
+        float dist = mirrored? py + 2.0f * px : px + 2.0f * py;
+        float line_size = pixel_size * sqrtf(5.0f);
+        if (dist > 1.0f + line_size / 2.0f) {
+            return w4;
+        }
+        vec4 r = CORNER();
+        if (dist < 1.0f - line_size / 2.0f) {
+            return r;
+        }
+        return mix(r, w4, (dist + line_size / 2.0f - 1.0f) / line_size);
+    }
+    if (P(0x1B,0x03) || P(0x4F,0x43) || P(0x8B,0x83) || P(0x6B,0x43)) {
+        return mix(w4, w3, 0.5f - px);
+    }
+    if (P(0x4B,0x09) || P(0x8B,0x89) || P(0x1F,0x19) || P(0x3B,0x19)) {
+        return mix(w4, w1, 0.5f - py);
+    }
+    if (P(0xFB,0x6A) || P(0x6F,0x6E) || P(0x3F,0x3E) || P(0xFB,0xFA) ||
+        P(0xDF,0xDE) || P(0xDF,0x1E)) {
+        return mix(w4, w0, (1.0f - px - py) / 2.0f);
+    }
+    if (P(0x4F,0x4B) || P(0x9F,0x1B) || P(0x2F,0x0B) ||
+        P(0xBE,0x0A) || P(0xEE,0x0A) || P(0x7E,0x0A) || P(0xEB,0x4B) ||
+        P(0x3B,0x1B)) {
+        float dist = px + py;
+        if (dist > 0.5f + pixel_size / 2.0f) {
+            return w4;
+        }
+        vec4 r = CORNER();
+        if (dist < 0.5f - pixel_size / 2.0f) {
+            return r;
+        }
+        return mix(r, w4, (dist + pixel_size / 2.0f - 0.5f) / pixel_size);
+    }
+    if (P(0x0B,0x01)) {
+        return mix(mix(w4, w3, 0.5f - px), mix(w1, (w1 + w3) / 2.0f, 0.5f - px), 0.5f - py);
+    }
+    if (P(0x0B,0x00)) {
+        return mix(mix(w4, w3, 0.5f - px), mix(w1, w0, 0.5f - px), 0.5f - py);
+    }
+
+    float dist = px + py;
+    if (dist > 0.5f + pixel_size / 2.0f) {
+        return w4;
+    }
+
+    /* We need more samples to "solve" this diagonal */
+    if (is_different(SAMPLE(hq, -ox * 2, -oy * 2), h4)) pattern |= 1 << 8;
+    if (is_different(SAMPLE(hq, -ox    , -oy * 2), h4)) pattern |= 1 << 9;
+    if (is_different(SAMPLE(hq,  0     , -oy * 2), h4)) pattern |= 1 << 10;
+    if (is_different(SAMPLE(hq,  ox    , -oy * 2), h4)) pattern |= 1 << 11;
+    if (is_different(SAMPLE(hq, -ox * 2, -oy    ), h4)) pattern |= 1 << 12;
+    if (is_different(SAMPLE(hq, -ox * 2,  0     ), h4)) pattern |= 1 << 13;
+    if (is_different(SAMPLE(hq, -ox * 2,  oy    ), h4)) pattern |= 1 << 14;
+    #undef SAMPLE
+    #undef CORNER
+
+    if ((signed)__builtin_popcount(pattern) - 7 <= 0) {
+        vec4 r = mix(w1, w3, py - px + 0.5f);
+        if (dist < 0.5f - pixel_size / 2.0f) {
+            return r;
+        }
+        return mix(r, w4, (dist + pixel_size / 2.0f - 0.5f) / pixel_size);
+    }
+
+    return w4;
+}
+
+#undef P
+
+static void omniscale_band(scale_context_t *context, unsigned first_row, unsigned last_row)
+{
+    unsigned factor = context->factor;
+    unsigned output_width = context->width * factor;
+    for (unsigned y = first_row; y < last_row; y++) {
+        float py = ((y % factor) * 2 + 1) / (2.0f * factor);
+        uint32_t *dest = context->dest + y * output_width;
+        for (unsigned x = 0; x < output_width; x++) {
+            unsigned index = y / factor * context->width + x / factor;
+            // Every branch reduces to the center color when there is nothing to interpolate
+            if (context->patterns[index] & FLAT_PIXEL) {
+                dest[x] = context->image[index];
+                continue;
+            }
+            float px = ((x % factor) * 2 + 1) / (2.0f * factor);
+            dest[x] = from_linear(omniscale_pixel(context, x / factor, y / factor, px, py), &context->layout);
+        }
+    }
+}
+
+static void nearest_neighbor_band(scale_context_t *context, unsigned first_row, unsigned last_row)
+{
+    unsigned factor = context->factor;
+    unsigned output_width = context->width * factor;
+    for (unsigned y = first_row; y < last_row; y++) {
+        const uint32_t *source = context->image + y / factor * context->width;
+        uint32_t *dest = context->dest + y * output_width;
+        for (unsigned x = 0; x < output_width; x++) {
+            dest[x] = source[x / factor];
+        }
+    }
+}
+
+static void convert_to_linear_band(scale_context_t *context, unsigned first_row, unsigned last_row)
+{
+    for (unsigned i = first_row * context->width; i < last_row * context->width; i++) {
+        context->linear[i] = to_linear(context->image[i], &context->layout);
+        context->hq[i] = rgb_to_hq_colorspace(context->linear[i]);
+    }
+}
+
+static void find_patterns_band(scale_context_t *context, unsigned first_row, unsigned last_row)
+{
+    unsigned width = context->width;
+    unsigned height = context->height;
+    for (unsigned y = first_row; y < last_row; y++) {
+        unsigned up = clamp_coordinate(y - 1, height) * width, middle = y * width;
+        unsigned down = clamp_coordinate(y + 1, height) * width;
+        for (unsigned x = 0; x < width; x++) {
+            unsigned left = clamp_coordinate(x - 1, width), right = clamp_coordinate(x + 1, width);
+            const unsigned neighbors[8] = {
+                up + left,     up + x,   up + right,
+                middle + left,           middle + right,
+                down + left,   down + x, down + right,
+            };
+            uint32_t center = context->image[middle + x];
+            vec4 hq = context->hq[middle + x];
+            uint16_t pattern = FLAT_PIXEL;
+            for (unsigned i = 0; i < 8; i++) {
+                pattern |= is_different(context->hq[neighbors[i]], hq) << i;
+                if (context->image[neighbors[i]] != center) {
+                    pattern &= ~FLAT_PIXEL;
+                }
+            }
+            context->patterns[middle + x] = pattern;
+        }
+    }
+}
+
+/* Maps output pixel centers to the image pixel and the half of it they fall in */
+static void map_output_positions(unsigned *positions, unsigned output_size, unsigned image_size)
+{
+    for (unsigned i = 0; i < output_size; i++) {
+        unsigned numerator = (i * 2 + 1) * image_size;
+        unsigned denominator = output_size * 2;
+        positions[i] = (numerator / denominator) * 2 + ((numerator % denominator) * 2 > denominator);
+    }
+}
+
+GB_pixel_channels_t GB_get_pixel_channels(GB_gameboy_t *gb)
+{
+    if (!gb->rgb_encode_callback) {
+        return (GB_pixel_channels_t){0, 8, 16};
+    }
+    uint32_t red = gb->rgb_encode_callback(gb, 0xFF, 0, 0);
+    uint32_t green = gb->rgb_encode_callback(gb, 0, 0xFF, 0);
+    uint32_t blue = gb->rgb_encode_callback(gb, 0, 0, 0xFF);
+    return (GB_pixel_channels_t){
+        red? __builtin_ctz(red) & ~7 : 0,
+        green? __builtin_ctz(green) & ~7 : 8,
+        blue? __builtin_ctz(blue) & ~7 : 16,
+    };
+}
+
+bool GB_get_scaler_by_name(const char *name, GB_scaler_t *scaler)
+{
+    static const struct {
+        const char *name;
+        GB_scaler_t scaler;
+    } scalers[] = {
+        {"NearestNeighbor", GB_SCALER_NEAREST_NEIGHBOR},
+        {"Scale2x", GB_SCALER_SCALE2X},
+        {"Scale4x", GB_SCALER_SCALE4X},
+        {"AAScale2x", GB_SCALER_AA_SCALE2X},
+        {"AAScale4x", GB_SCALER_AA_SCALE4X},
+        {"HQ2x", GB_SCALER_HQ2X},
+        {"OmniScale", GB_SCALER_OMNISCALE},
+    };
+
+    for (unsigned i = 0; i < sizeof(scalers) / sizeof(scalers[0]); i++) {
+        if (strcmp(scalers[i].name, name) == 0) {
+            *scaler = scalers[i].scaler;
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned GB_get_scaler_factor(GB_scaler_t scaler)
+{
+    switch (scaler) {
+        case GB_SCALER_NEAREST_NEIGHBOR: return 1;
+        case GB_SCALER_SCALE4X:
+        case GB_SCALER_AA_SCALE4X:
+        case GB_SCALER_OMNISCALE: return 4;
+        default: return 2;
+    }
+}
+
+void GB_scale_image(GB_scaler_t scaler, uint32_t *dest, const uint32_t *src, unsigned width, unsigned height,
+                    unsigned factor, GB_pixel_channels_t channels, unsigned max_threads)
+{
+    if (!width || !height || !factor) return;
+    build_tables();
+
+    unsigned output_width = width * factor, output_height = height * factor;
+    unsigned threads = MIN(max_threads, MAX_THREADS);
+
+    scale_context_t context = {
+        .scaler = scaler,
+        .layout = {{channels.red_shift, channels.green_shift, channels.blue_shift,
+                    48 - channels.red_shift - channels.green_shift - channels.blue_shift}},
+        .dest = dest,
+        .width = width,
+        .height = height,
+        .factor = factor,
+        .image = src,
+        .image_width = width,
+        .image_height = height,
+    };
+
+    switch (scaler) {
+        case GB_SCALER_NEAREST_NEIGHBOR:
+            run_bands(nearest_neighbor_band, &context, output_height, output_width, threads);
+            return;
+        case GB_SCALER_OMNISCALE:
+        case GB_SCALER_HQ2X:
+            context.linear = malloc(width * height * sizeof(context.linear[0]) * 2);
+            context.hq = context.linear + width * height;
+            context.patterns = malloc(width * height * sizeof(context.patterns[0]));
+            run_bands(convert_to_linear_band, &context, height, width, threads);
+            run_bands(find_patterns_band, &context, height, width, threads);
+            if (scaler == GB_SCALER_OMNISCALE) {
+                run_bands(omniscale_band, &context, output_height, output_width, threads);
+                free(context.linear);
+                free(context.patterns);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+
+    // Scale4x runs Scale2x twice, so its quadrants are of the Scale2x output
+    bool twice = scaler == GB_SCALER_SCALE4X || scaler == GB_SCALER_AA_SCALE4X;
+    unsigned size = width * height * (twice? 4 : 1);
+    uint32_t *buffer = malloc(size * sizeof(*buffer) * (twice? 5 : 4));
+    for (unsigned i = 0; i < 4; i++) {
+        context.quadrants[i] = buffer + size * i;
+    }
+    unsigned *positions = malloc((output_width + output_height + width * 2 + height * 2) * sizeof(*positions));
+
+    if (scaler == GB_SCALER_HQ2X) {
+        run_bands(hq2x_band, &context, height, width * 4, threads);
+        free(context.linear);
+        free(context.patterns);
+    }
+    else {
+        run_bands(scale2x_band, &context, height, width * 4, threads);
+    }
+
+    if (twice) {
+        // Expand the first pass into an image of twice the size, and run Scale2x on that
+        uint32_t *image = buffer + size * 4;
+        context.dest = image;
+        context.factor = 2;
+        context.columns = positions + output_width + output_height;
+        context.rows = context.columns + width * 2;
+        map_output_positions(context.columns, width * 2, width);
+        map_output_positions(context.rows, height * 2, height);
+        run_bands(expand_quadrants_band, &context, height * 2, width * 2, threads);
+
+        context.dest = dest;
+        context.factor = factor;
+        context.image = image;
+        context.image_width = width * 2;
+        context.image_height = height * 2;
+        run_bands(scale2x_band, &context, context.image_height, context.image_width * 4, threads);
+    }
+
+    if (scaler == GB_SCALER_AA_SCALE2X || scaler == GB_SCALER_AA_SCALE4X) {
+        run_bands(anti_alias_band, &context, context.image_height, context.image_width * 4, threads);
+    }
+
+    context.columns = positions;
+    context.rows = positions + output_width;
+    map_output_positions(context.columns, output_width, context.image_width);
+    map_output_positions(context.rows, output_height, context.image_height);
+    run_bands(expand_quadrants_band, &context, output_height, output_width, threads);
+
+    free(positions);
+    free(buffer);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "defs.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* CPU implementations of the scaling filters in Shaders/, for frontends without a GPU */
+typedef enum {
+    GB_SCALER_NEAREST_NEIGHBOR,
+    GB_SCALER_SCALE2X,
+    GB_SCALER_SCALE4X,
+    GB_SCALER_AA_SCALE2X,
+    GB_SCALER_AA_SCALE4X,
+    GB_SCALER_HQ2X,
+    GB_SCALER_OMNISCALE,
+} GB_scaler_t;
+
+/* Bit offsets of each 8-bit channel within a pixel, the remaining byte is treated as alpha */
+typedef struct {
+    uint8_t red_shift, green_shift, blue_shift;
+} GB_pixel_channels_t;
+
+GB_pixel_channels_t GB_get_pixel_channels(GB_gameboy_t *gb);
+/* Looks a scaler up by its shader's file name (e.g. "HQ2x"), returns false if there is no CPU implementation */
+bool GB_get_scaler_by_name(const char *name, GB_scaler_t *scaler);
+/* The factor a scaler is designed for; OmniScale can scale to any factor */
+unsigned GB_get_scaler_factor(GB_scaler_t scaler);
+/* Scales a tightly packed image into dest, which must fit (width * factor) x (height * factor) pixels. Large outputs
+   are split into row bands rendered by up to max_threads threads. */
+void GB_scale_image(GB_scaler_t scaler, uint32_t *dest, const uint32_t *src, unsigned width, unsigned height,
+                    unsigned factor, GB_pixel_channels_t channels, unsigned max_threads);
@@ -2,6 +2,7 @@
 #include "random.h"
 #include <math.h>
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifndef M_PI
@@ -535,9 +536,10 @@ static uint32_t convert_rgb15_with_fade(GB_gameboy_t *gb, uint16_t color, uint8_
 static void render_boot_animation (GB_gameboy_t *gb)
 {
 #include "graphics/sgb_animation_logo.inc"
+    unsigned pitch = GB_get_screen_pitch(gb);
     uint32_t *output = gb->screen;
     if (gb->border_mode != GB_BORDER_NEVER) {
-        output += 48 + 40 * 256;
+        output += 48 + 40 * pitch;
     }
     uint8_t *input = animation_logo;
     unsigned fade_blue = 0;
@@ -586,8 +588,179 @@ static void render_boot_animation (GB_gameboy_t *gb)
                 input++;
             }
         }
-        if (gb->border_mode != GB_BORDER_NEVER) {
-            output += 256 - 160;
+        output += pitch - 160;
+    }
+}
+
+struct GB_sgb_border_cache_s {
+    /* Inputs the border was composed from */
+    GB_sgb_border_t border;
+    uint32_t border_colors[16 * 4];
+    uint32_t background;
+    bool valid;
+    
+    /* The composed 256x224 border; pixels inside the Game Boy area are only used where overlay is set */
+    uint32_t pixels[256 * 224];
+    bool overlay[160 * 144];
+    bool overlay_rows[144];
+    bool unused_tiles[28 * 32];
+    bool has_unused_tiles;
+};
+
+static bool border_cache_is_valid(GB_gameboy_t *gb, const uint32_t *border_colors, uint32_t background)
+{
+    GB_sgb_border_cache_t *cache = gb->sgb_border_cache;
+    return cache->valid &&
+           cache->background == background &&
+           memcmp(cache->border_colors, border_colors, sizeof(cache->border_colors)) == 0 &&
+           memcmp(&cache->border, &gb->sgb->border, sizeof(cache->border)) == 0;
+}
+
+static void compose_border(GB_gameboy_t *gb, const uint32_t *border_colors, uint32_t background)
+{
+    GB_sgb_border_cache_t *cache = gb->sgb_border_cache;
+    memcpy(&cache->border, &gb->sgb->border, sizeof(cache->border));
+    memcpy(cache->border_colors, border_colors, sizeof(cache->border_colors));
+    cache->background = background;
+    cache->valid = true;
+    
+    memset(cache->overlay, 0, sizeof(cache->overlay));
+    memset(cache->overlay_rows, 0, sizeof(cache->overlay_rows));
+    cache->has_unused_tiles = false;
+    
+    for (unsigned tile_y = 0; tile_y < 28; tile_y++) {
+        for (unsigned tile_x = 0; tile_x < 32; tile_x++) {
+            bool gb_area = tile_x >= 6 && tile_x < 26 && tile_y >= 5 && tile_y < 23;
+            uint16_t tile = LE16(cache->border.map[tile_x + tile_y * 32]);
+            cache->unused_tiles[tile_x + tile_y * 32] = tile & 0x300;
+            if (tile & 0x300) { // Unused tile
+                if (!gb_area) {
+                    cache->has_unused_tiles = true;
+                }
+                continue;
+            }
+            uint8_t flip_x = (tile & 0x4000)? 0:7;
+            uint8_t flip_y = (tile & 0x8000)? 7:0;
+            uint8_t palette = (tile >> 10) & 3;
+            for (unsigned y = 0; y < 8; y++) {
+                unsigned base = (tile & 0xFF) * 32 + (y ^ flip_y) * 2;
+                for (unsigned x = 0; x < 8; x++) {
+                    uint8_t bit = 1 << (x ^ flip_x);
+                    uint8_t color = ((cache->border.tiles[base] & bit)      ? 1: 0) |
+                                    ((cache->border.tiles[base + 1] & bit)  ? 2: 0) |
+                                    ((cache->border.tiles[base + 16] & bit) ? 4: 0) |
+                                    ((cache->border.tiles[base + 17] & bit) ? 8: 0);
+                    
+                    uint32_t *output = cache->pixels + tile_x * 8 + x + (tile_y * 8 + y) * 256;
+                    if (color == 0) {
+                        if (gb_area) continue;
+                        *output = background;
+                    }
+                    else {
+                        *output = border_colors[color + palette * 16];
+                        if (gb_area) {
+                            unsigned gb_x = (tile_x - 6) * 8 + x;
+                            unsigned gb_y = (tile_y - 5) * 8 + y;
+                            cache->overlay[gb_x + gb_y * 160] = true;
+                            cache->overlay_rows[gb_y] = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void draw_border(GB_gameboy_t *gb, unsigned pitch)
+{
+    const GB_sgb_border_cache_t *cache = gb->sgb_border_cache;
+    uint32_t *gb_area = gb->screen;
+    if (gb->border_mode != GB_BORDER_NEVER) {
+        if (!cache->has_unused_tiles) {
+            for (unsigned y = 0; y < 224; y++) {
+                const uint32_t *input = cache->pixels + y * 256;
+                uint32_t *output = gb->screen + y * pitch;
+                if (y < 40 || y >= 184) {
+                    memcpy(output, input, 256 * sizeof(*output));
+                }
+                else {
+                    memcpy(output, input, 48 * sizeof(*output));
+                    memcpy(output + 208, input + 208, 48 * sizeof(*output));
+                }
+            }
+        }
+        else {
+            /* Unused tiles leave the output untouched */
+            for (unsigned tile_y = 0; tile_y < 28; tile_y++) {
+                for (unsigned tile_x = 0; tile_x < 32; tile_x++) {
+                    if (tile_x >= 6 && tile_x < 26 && tile_y >= 5 && tile_y < 23) continue;
+                    if (cache->unused_tiles[tile_x + tile_y * 32]) continue;
+                    for (unsigned y = tile_y * 8; y < tile_y * 8 + 8; y++) {
+                        memcpy(gb->screen + tile_x * 8 + y * pitch,
+                               cache->pixels + tile_x * 8 + y * 256,
+                               8 * sizeof(*gb->screen));
+                    }
+                }
+            }
+        }
+        gb_area += 48 + 40 * pitch;
+    }
+    
+    for (unsigned y = 0; y < 144; y++) {
+        if (!cache->overlay_rows[y]) continue;
+        const uint32_t *input = cache->pixels + 48 + (y + 40) * 256;
+        const bool *overlay = cache->overlay + y * 160;
+        uint32_t *output = gb_area + y * pitch;
+        for (unsigned x = 0; x < 160; x++) {
+            if (overlay[x]) {
+                output[x] = input[x];
+            }
+        }
+    }
+}
+
+/* Used if the cache can't be allocated */
+static void draw_border_uncached(GB_gameboy_t *gb, const uint32_t *border_colors, uint32_t background, unsigned pitch)
+{
+    for (unsigned tile_y = 0; tile_y < 28; tile_y++) {
+        for (unsigned tile_x = 0; tile_x < 32; tile_x++) {
+            bool gb_area = false;
+            if (tile_x >= 6 && tile_x < 26 && tile_y >= 5 && tile_y < 23) {
+                gb_area = true;
+            }
+            else if (gb->border_mode == GB_BORDER_NEVER) {
+                continue;
+            }
+            uint16_t tile = LE16(gb->sgb->border.map[tile_x + tile_y * 32]);
+            if (tile & 0x300) continue; // Unused tile
+            uint8_t flip_x = (tile & 0x4000)? 0:7;
+            uint8_t flip_y = (tile & 0x8000)? 7:0;
+            uint8_t palette = (tile >> 10) & 3;
+            for (unsigned y = 0; y < 8; y++) {
+                unsigned base = (tile & 0xFF) * 32 + (y ^ flip_y) * 2;
+                for (unsigned x = 0; x < 8; x++) {
+                    uint8_t bit = 1 << (x ^ flip_x);
+                    uint8_t color = ((gb->sgb->border.tiles[base] & bit)      ? 1: 0) |
+                                    ((gb->sgb->border.tiles[base + 1] & bit)  ? 2: 0) |
+                                    ((gb->sgb->border.tiles[base + 16] & bit) ? 4: 0) |
+                                    ((gb->sgb->border.tiles[base + 17] & bit) ? 8: 0);
+                    
+                    uint32_t *output = gb->screen;
+                    if (gb->border_mode == GB_BORDER_NEVER) {
+                        output += (tile_x - 6) * 8 + x + ((tile_y - 5) * 8 + y) * pitch;
+                    }
+                    else {
+                        output += tile_x * 8 + x + (tile_y * 8 + y) * pitch;
+                    }
+                    if (color == 0) {
+                        if (gb_area) continue;
+                        *output = background;
+                    }
+                    else {
+                       *output = border_colors[color + palette * 16];
+                    }
+                }
+            }
         }
     }
 }
@@ -665,6 +838,7 @@ void GB_sgb_render(GB_gameboy_t *gb, bool incomplete)
         return;
     }
 
+    unsigned pitch = GB_get_screen_pitch(gb);
     uint32_t colors[4 * 4];
     for (unsigned i = 0; i < 4 * 4; i++) {
         colors[i] = convert_rgb15(gb, LE16(gb->sgb->effective_palettes[i]));
@@ -682,7 +856,7 @@ void GB_sgb_render(GB_gameboy_t *gb, bool incomplete)
     else {
         uint32_t *output = gb->screen;
         if (gb->border_mode != GB_BORDER_NEVER) {
-            output += 48 + 40 * 256;
+            output += 48 + 40 * pitch;
         }
         uint8_t *input = gb->sgb->effective_screen_buffer;
         switch ((mask_mode_t) gb->sgb->mask_mode) {
@@ -693,9 +867,7 @@ void GB_sgb_render(GB_gameboy_t *gb, bool incomplete)
                         uint8_t palette = gb->sgb->attribute_map[x / 8 + y / 8 * 20] & 3;
                         *(output++) = colors[(*(input++) & 3) + palette * 4];
                     }
-                    if (gb->border_mode != GB_BORDER_NEVER) {
-                        output += 256 - 160;
-                    }
+                    output += pitch - 160;
                 }
                 break;
             }
@@ -706,9 +878,7 @@ void GB_sgb_render(GB_gameboy_t *gb, bool incomplete)
                     for (unsigned x = 0; x < 160; x++) {
                         *(output++) = black;
                     }
-                    if (gb->border_mode != GB_BORDER_NEVER) {
-                        output += 256 - 160;
-                    }
+                    output += pitch - 160;
                 }
                 break;
             }
@@ -718,9 +888,7 @@ void GB_sgb_render(GB_gameboy_t *gb, bool incomplete)
                     for (unsigned x = 0; x < 160; x++) {
                         *(output++) = colors[0];
                     }
-                    if (gb->border_mode != GB_BORDER_NEVER) {
-                        output += 256 - 160;
-                    }
+                    output += pitch - 160;
                 }
                 break;
             }
@@ -754,47 +922,18 @@ void GB_sgb_render(GB_gameboy_t *gb, bool incomplete)
         memcpy(&gb->sgb->border, &gb->sgb->pending_border, sizeof(gb->sgb->border));
     }
     
-    for (unsigned tile_y = 0; tile_y < 28; tile_y++) {
-        for (unsigned tile_x = 0; tile_x < 32; tile_x++) {
-            bool gb_area = false;
-            if (tile_x >= 6 && tile_x < 26 && tile_y >= 5 && tile_y < 23) {
-                gb_area = true;
-            }
-            else if (gb->border_mode == GB_BORDER_NEVER) {
-                continue;
-            }
-            uint16_t tile = LE16(gb->sgb->border.map[tile_x + tile_y * 32]);
-            if (tile & 0x300) continue; // Unused tile
-            uint8_t flip_x = (tile & 0x4000)? 0:7;
-            uint8_t flip_y = (tile & 0x8000)? 7:0;
-            uint8_t palette = (tile >> 10) & 3;
-            for (unsigned y = 0; y < 8; y++) {
-                unsigned base = (tile & 0xFF) * 32 + (y ^ flip_y) * 2;
-                for (unsigned x = 0; x < 8; x++) {
-                    uint8_t bit = 1 << (x ^ flip_x);
-                    uint8_t color = ((gb->sgb->border.tiles[base] & bit)      ? 1: 0) |
-                                    ((gb->sgb->border.tiles[base + 1] & bit)  ? 2: 0) |
-                                    ((gb->sgb->border.tiles[base + 16] & bit) ? 4: 0) |
-                                    ((gb->sgb->border.tiles[base + 17] & bit) ? 8: 0);
-                    
-                    uint32_t *output = gb->screen;
-                    if (gb->border_mode == GB_BORDER_NEVER) {
-                        output += (tile_x - 6) * 8 + x + ((tile_y - 5) * 8 + y) * 160;
-                    }
-                    else {
-                        output += tile_x * 8 + x + (tile_y * 8 + y) * 256;
-                    }
-                    if (color == 0) {
-                        if (gb_area) continue;
-                        *output = colors[0];
-                    }
-                    else {
-                       *output = border_colors[color + palette * 16];
-                    }
-                }
-            }
+    if (!gb->sgb_border_cache) {
+        gb->sgb_border_cache = malloc(sizeof(*gb->sgb_border_cache));
+        if (!gb->sgb_border_cache) {
+            draw_border_uncached(gb, border_colors, colors[0], pitch);
+            return;
         }
+        gb->sgb_border_cache->valid = false;
     }
+    if (!border_cache_is_valid(gb, border_colors, colors[0])) {
+        compose_border(gb, border_colors, colors[0]);
+    }
+    draw_border(gb, pitch);
 }
 
 void GB_sgb_load_default_data(GB_gameboy_t *gb)
@@ -831,55 +970,87 @@ void GB_sgb_load_default_data(GB_gameboy_t *gb)
     gb->sgb->effective_palettes[3] = LE16(built_in_palettes[3]);
 }
 
-static double fm_sin(double phase)
-{
 #define SIN_TABLE_LENGTH 128
+static double sin_table[SIN_TABLE_LENGTH + 1];
+
+static void init_sin_table(void)
+{
+    static bool once = false;
+    if (__atomic_load_n(&once, __ATOMIC_ACQUIRE)) return;
+    for (unsigned i = 0; i < SIN_TABLE_LENGTH + 1; i++) {
+        sin_table[i] = sin(i * M_PI / 2 / SIN_TABLE_LENGTH);
+    }
+    __atomic_store_n(&once, true, __ATOMIC_RELEASE);
+}
+
+static inline double fm_sin(double phase)
+{
     phase /= 2 * M_PI;
     phase = fabs(phase);
     phase -= floor(phase);
+    double sign = 1;
+    /* The mirrored quarters are looked up at a scaled-down phase, this is part of the jingle's timbre */
     if (phase > 0.5) {
-        return -(fm_sin(1 - phase));
-    }
-    if (phase > 0.25) {
-        return fm_sin(0.5 - phase);
+        phase = (1 - phase) / (2 * M_PI);
+        sign = -1;
     }
-    
-    static bool once = false;
-    static double table[SIN_TABLE_LENGTH + 1];
-    if (!once) {
-        for (unsigned i = 0; i < SIN_TABLE_LENGTH + 1; i++) {
-            table[i] = sin(i * M_PI / 2 / SIN_TABLE_LENGTH);
-        }
-        once = true;
+    else if (phase > 0.25) {
+        phase = (0.5 - phase) / (2 * M_PI);
     }
     
     phase *= 4 * SIN_TABLE_LENGTH;
     double fraction = phase - floor(phase);
-    return table[(unsigned)floor(phase)] * (1 - fraction) + table[(unsigned)ceil(phase)] * (fraction);
+    return sign * (sin_table[(unsigned)floor(phase)] * (1 - fraction) + sin_table[(unsigned)ceil(phase)] * (fraction));
 }
 
 static double fm_synth(double phase)
 {
-    return (fm_sin(phase * M_PI * 2) +
-            fm_sin(phase * M_PI * 2 + fm_sin(phase * M_PI * 2)) +
-            fm_sin(phase * M_PI * 2 + fm_sin(phase * M_PI * 3)) +
-            fm_sin(phase * M_PI * 2 + fm_sin(phase * M_PI * 4))) / 4;
+    phase *= M_PI * 2;
+    return (fm_sin(phase) +
+            fm_sin(phase + fm_sin(phase)) +
+            fm_sin(phase + fm_sin(phase * 1.5)) +
+            fm_sin(phase + fm_sin(phase * 2))) / 4;
 }
 
 static double fm_sweep(double phase)
 {
+    static const double multipliers[8] = {1, 1.25, 1.5625, 1.953125, 2.44140625, 3.0517578125, 3.814697265625, 4.76837158203125};
     double ret = 0;
+    phase = phase * M_PI * 2 + fm_sin(phase * M_PI * 8) / 4;
     for (unsigned i = 0; i < 8; i++) {
-        ret += fm_sin((phase * M_PI * 2 + fm_sin(phase * M_PI * 8) / 4) * pow(1.25, i)) * (8 - i) / 36;
+        ret += fm_sin(phase * multipliers[i]) * (8 - i);
     }
-    return ret;
+    return ret / 36;
 }
+
 static double random_double(void)
 {
     return ((signed)(GB_random32() % 0x10001) - 0x8000) / (double) 0x8000;
 }
 
-static void render_jingle(GB_gameboy_t *gb, size_t count)
+/* The jingle only depends on the sample rate and frame length, so it's rendered once and shared between instances.
+   Frames are synthesized on first use, so no single frame pays for the whole jingle. */
+typedef struct jingle_s {
+    struct jingle_s *next;
+    unsigned sample_rate;
+    size_t samples_per_frame;
+    
+    bool lock;
+    signed rendered_frames;
+    double phases[7];
+    double sweep_phase;
+    double sweep_previous_sample;
+    
+    int16_t samples[];
+} jingle_t;
+
+static jingle_t *jingles;
+/* Instances that looked up a jingle. The list is freed when the last of them is freed, so it never has to be freed
+   while another instance is reading it. */
+static unsigned jingle_users;
+static bool jingle_users_lock;
+
+static void synthesize_jingle_frame(jingle_t *jingle, signed frame)
 {
     const double frequencies[7] = {
         466.16, // Bb4
@@ -891,25 +1062,16 @@ static void render_jingle(GB_gameboy_t *gb, size_t count)
         1567.98, // G6
     };
     
-    assert(gb->apu_output.sample_callback);
+    size_t count = jingle->samples_per_frame;
+    int16_t *output = jingle->samples + frame * count;
     
-    if (gb->sgb->intro_animation < 0) {
-        GB_sample_t sample = {0, 0};
-        for (unsigned i = 0; i < count; i++) {
-            gb->apu_output.sample_callback(gb, &sample);
-        }
-        return;
-    }
-    
-    if (gb->sgb->intro_animation >= GB_SGB_INTRO_ANIMATION_LENGTH) return;
-    
-    signed jingle_stage = (gb->sgb->intro_animation - 64) / 3;
-    double sweep_cutoff_ratio = 2000.0 * pow(2, gb->sgb->intro_animation / 20.0) / gb->apu_output.sample_rate;
-    double sweep_phase_shift = 1000.0 * pow(2, gb->sgb->intro_animation / 40.0) / gb->apu_output.sample_rate;
+    signed jingle_stage = (frame - 64) / 3;
+    double sweep_cutoff_ratio = 2000.0 * pow(2, frame / 20.0) / jingle->sample_rate;
+    double sweep_phase_shift = 1000.0 * pow(2, frame / 40.0) / jingle->sample_rate;
     if (sweep_cutoff_ratio > 1) {
         sweep_cutoff_ratio = 1;
     }
-
+    
     // Render at a lower resolution if our sample rate is too high
     uint8_t downsample_mask = 0;
     size_t temp_count = count;
@@ -921,36 +1083,124 @@ static void render_jingle(GB_gameboy_t *gb, size_t count)
         sweep_cutoff_ratio *= 2;
     }
     
-    GB_sample_t stereo = {0, 0};
+    double volumes[7];
+    double phase_shifts[7];
+    for (signed f = 0; f < 7 && f < jingle_stage; f++) {
+        volumes[f] = (0.75 * pow(0.5, jingle_stage - f) + 0.25) / 5.0;
+        phase_shifts[f] = (frequencies[f] / jingle->sample_rate) * (downsample_mask + 1);
+    }
+    double fade = 1;
+    if (frame > 100) {
+        fade = pow((GB_SGB_INTRO_ANIMATION_LENGTH - frame) / (GB_SGB_INTRO_ANIMATION_LENGTH - 100.0), 3);
+    }
+    double sweep_volume = pow((120 - frame) / 120.0, 2) * 0.8;
+    
+    int16_t value = 0;
     for (unsigned i = 0; i < count; i++) {
         if ((i & downsample_mask)) {
-            gb->apu_output.sample_callback(gb, &stereo);
+            *(output++) = value;
             continue;
         }
         double sample = 0;
         for (signed f = 0; f < 7 && f < jingle_stage; f++) {
-            sample += fm_synth(gb->sgb_intro_jingle_phases[f]) *
-                      (0.75 * pow(0.5, jingle_stage - f) + 0.25) / 5.0;
-            gb->sgb_intro_jingle_phases[f] += (frequencies[f] / gb->apu_output.sample_rate) * (downsample_mask + 1);
+            sample += fm_synth(jingle->phases[f]) * volumes[f];
+            jingle->phases[f] += phase_shifts[f];
         }
-        if (gb->sgb->intro_animation > 100) {
-            sample *= pow((GB_SGB_INTRO_ANIMATION_LENGTH - gb->sgb->intro_animation) / (GB_SGB_INTRO_ANIMATION_LENGTH - 100.0), 3);
+        sample *= fade;
+        
+        if (frame < 120) {
+            double next = fm_sweep(jingle->sweep_phase) * 0.3 + random_double() * 0.7;
+            jingle->sweep_phase += sweep_phase_shift;
+            
+            jingle->sweep_previous_sample = next * (sweep_cutoff_ratio) +
+                                            jingle->sweep_previous_sample * (1 - sweep_cutoff_ratio);
+            sample += jingle->sweep_previous_sample * sweep_volume;
         }
         
-        if (gb->sgb->intro_animation < 120) {
-            double next = fm_sweep(gb->sgb_intro_sweep_phase) * 0.3 + random_double() * 0.7;
-            gb->sgb_intro_sweep_phase += sweep_phase_shift;
+        value = sample * 0x7000;
+        *(output++) = value;
+    }
+}
 
-            gb->sgb_intro_sweep_previous_sample = next * (sweep_cutoff_ratio) +
-                                                  gb->sgb_intro_sweep_previous_sample * (1 - sweep_cutoff_ratio);
-            sample += gb->sgb_intro_sweep_previous_sample * pow((120 - gb->sgb->intro_animation) / 120.0, 2) * 0.8;
+static jingle_t *get_jingle(GB_gameboy_t *gb, unsigned sample_rate, size_t count)
+{
+    if (!gb->sgb_jingle_user) {
+        while (__atomic_test_and_set(&jingle_users_lock, __ATOMIC_ACQUIRE));
+        jingle_users++;
+        __atomic_clear(&jingle_users_lock, __ATOMIC_RELEASE);
+        gb->sgb_jingle_user = true;
+    }
+    
+    for (jingle_t *jingle = __atomic_load_n(&jingles, __ATOMIC_ACQUIRE); jingle; jingle = jingle->next) {
+        if (jingle->sample_rate == sample_rate && jingle->samples_per_frame == count) {
+            return jingle;
         }
-        
-        stereo.left = stereo.right = sample * 0x7000;
-        gb->apu_output.sample_callback(gb, &stereo);
     }
     
-    return;
+    jingle_t *jingle = malloc(sizeof(*jingle) + sizeof(jingle->samples[0]) * count * GB_SGB_INTRO_ANIMATION_LENGTH);
+    if (!jingle) return NULL;
+    memset(jingle, 0, sizeof(*jingle));
+    jingle->sample_rate = sample_rate;
+    jingle->samples_per_frame = count;
+    init_sin_table();
+    
+    /* If another instance added the same jingle concurrently, both copies are kept; this is harmless */
+    jingle->next = __atomic_load_n(&jingles, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&jingles, &jingle->next, jingle, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return jingle;
+}
+
+void GB_sgb_release_jingles(GB_gameboy_t *gb)
+{
+    if (!gb->sgb_jingle_user) return;
+    gb->sgb_jingle_user = false;
+    while (__atomic_test_and_set(&jingle_users_lock, __ATOMIC_ACQUIRE));
+    if (--jingle_users == 0) {
+        jingle_t *jingle = jingles;
+        jingles = NULL;
+        while (jingle) {
+            jingle_t *next = jingle->next;
+            free(jingle);
+            jingle = next;
+        }
+    }
+    __atomic_clear(&jingle_users_lock, __ATOMIC_RELEASE);
+}
+
+static const int16_t *get_jingle_frame(jingle_t *jingle, signed frame)
+{
+    if (frame >= __atomic_load_n(&jingle->rendered_frames, __ATOMIC_ACQUIRE)) {
+        while (__atomic_test_and_set(&jingle->lock, __ATOMIC_ACQUIRE));
+        while (jingle->rendered_frames <= frame) {
+            synthesize_jingle_frame(jingle, jingle->rendered_frames);
+            __atomic_store_n(&jingle->rendered_frames, jingle->rendered_frames + 1, __ATOMIC_RELEASE);
+        }
+        __atomic_clear(&jingle->lock, __ATOMIC_RELEASE);
+    }
+    return jingle->samples + frame * jingle->samples_per_frame;
+}
+
+static void render_jingle(GB_gameboy_t *gb, size_t count)
+{
+    if (gb->sgb->intro_animation < 0) {
+        GB_sample_t sample = {0, 0};
+        for (unsigned i = 0; i < count; i++) {
+            GB_apu_output_sample(gb, &sample);
+        }
+        return;
+    }
+    
+    if (gb->sgb->intro_animation >= GB_SGB_INTRO_ANIMATION_LENGTH) return;
+    
+    jingle_t *jingle = get_jingle(gb, gb->apu_output.sample_rate, count);
+    const int16_t *samples = jingle? get_jingle_frame(jingle, gb->sgb->intro_animation) : NULL;
+    GB_sample_t stereo = {0, 0};
+    for (unsigned i = 0; i < count; i++) {
+        if (samples) {
+            stereo.left = stereo.right = samples[i];
+        }
+        GB_apu_output_sample(gb, &stereo);
+    }
 }
 
 unsigned GB_get_player_count(GB_gameboy_t *gb)
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 
 typedef struct GB_sgb_s GB_sgb_t;
+typedef struct GB_sgb_border_cache_s GB_sgb_border_cache_t;
 typedef struct {
     uint8_t tiles[0x100 * 8 * 4];
 #ifdef GB_INTERNAL
@@ -65,6 +66,7 @@ struct GB_sgb_s {
 internal void GB_sgb_write(GB_gameboy_t *gb, uint8_t value);
 internal void GB_sgb_render(GB_gameboy_t *gb, bool incomplete);
 internal void GB_sgb_load_default_data(GB_gameboy_t *gb);
+internal void GB_sgb_release_jingles(GB_gameboy_t *gb);
 
 #endif
 unsigned GB_get_player_count(GB_gameboy_t *gb);
@@ -1630,6 +1630,18 @@ void GB_cpu_run(GB_gameboy_t *gb)
     
     if (gb->halted) {
         GB_advance_cycles(gb, (GB_is_cgb(gb) || gb->just_halted) ? 4 : 2);
+        /* Sound drivers spend most of their time halted, idle until something happens instead of returning to
+           GB_run every M-cycle. The sequence of cycles is the same as above. */
+        if (unlikely(gb->audio_only)) {
+            while (gb->halted && !interrupt_queue && !gb->ime_toggle && !gb->vblank_just_occured &&
+                   !(gb->interrupt_enable & 0x10)) {
+                if (!GB_is_cgb(gb)) {
+                    GB_advance_cycles(gb, 2);
+                }
+                interrupt_queue = gb->interrupt_enable & gb->io_registers[GB_IO_IF] & 0x1F;
+                GB_advance_cycles(gb, GB_is_cgb(gb)? 4 : 2);
+            }
+        }
     }
     gb->just_halted = false;
 
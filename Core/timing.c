@@ -78,6 +78,21 @@ void GB_timing_sync(GB_gameboy_t *gb)
     }
     else {
         target_clock_rate = GB_get_clock_rate(gb);
+        if (gb->audio_sync_callback) {
+            /* Paced by the audio device, the callback blocks until its queue has room */
+            GB_apu_flush_sample_buffer(gb);
+            int64_t start = get_nanoseconds();
+            if (gb->audio_sync_callback(gb)) {
+                int64_t nanoseconds = get_nanoseconds();
+                gb->adaptive_frameskip.slept_nanoseconds += nanoseconds - start;
+                gb->last_sync = nanoseconds;
+                gb->cycles_since_last_sync = 0;
+                if (gb->update_input_hint_callback) {
+                    gb->update_input_hint_callback(gb);
+                }
+                return;
+            }
+        }
     }
     
     uint64_t target_nanoseconds = gb->cycles_since_last_sync * 1000000000LL / 2 / target_clock_rate; /* / 2 because we use 8MHz units */
@@ -85,10 +100,13 @@ void GB_timing_sync(GB_gameboy_t *gb)
     int64_t time_to_sleep = target_nanoseconds + gb->last_sync - nanoseconds;
     if (time_to_sleep > 0 && time_to_sleep < LCDC_PERIOD * 1200000000LL / target_clock_rate) { // +20% to be more forgiving
         nsleep(time_to_sleep);
+        gb->adaptive_frameskip.slept_nanoseconds += time_to_sleep;
         gb->last_sync += target_nanoseconds;
     }
     else {
-        if (time_to_sleep < 0 && -time_to_sleep < LCDC_PERIOD * 1200000000LL / target_clock_rate) {
+        // With adaptive frameskip, skipped frames are expected to catch up with slow rendered frames
+        int64_t tolerance = LCDC_PERIOD * 1200000000LL / target_clock_rate * (gb->turbo? 1 : 1 + gb->adaptive_frameskip.max_skipped_frames);
+        if (time_to_sleep < 0 && -time_to_sleep < tolerance) {
             // We're running a bit too slow, but the difference is small enough,
             // just skip this sync and let it even out
             return;
@@ -101,6 +119,68 @@ void GB_timing_sync(GB_gameboy_t *gb)
         gb->update_input_hint_callback(gb);
     }
 }
+
+bool GB_timing_adaptive_frameskip(GB_gameboy_t *gb)
+{
+    typeof(gb->adaptive_frameskip) *state = &gb->adaptive_frameskip;
+    bool skipped = state->skipping;
+    int64_t nanoseconds = get_nanoseconds();
+    int64_t frame_length = LCDC_PERIOD * 1000000000LL / GB_get_clock_rate(gb);
+    int64_t busy = nanoseconds - state->frame_start - state->slept_nanoseconds;
+    
+    /* Ignore the first frame and long pauses, such as the debugger or a frontend menu */
+    if (state->frame_start && nanoseconds - state->frame_start < frame_length * 10) {
+        state->measured_nanoseconds += busy;
+        state->measured_frames++;
+    }
+    state->frame_start = nanoseconds;
+    state->slept_nanoseconds = 0;
+    
+    if (state->countdown) {
+        state->countdown--;
+    }
+    else if (state->measured_frames) {
+        /* Re-evaluate once per rendered frame and its skipped frames. Frames must be consistently cheap before
+           skipping fewer of them, so the level doesn't oscillate. */
+        int64_t average = state->measured_nanoseconds / state->measured_frames;
+        if (average > frame_length) {
+            if (state->level < state->max_skipped_frames) {
+                state->level++;
+            }
+            state->calm_frames = 0;
+        }
+        else if (average < frame_length * 3 / 4) {
+            state->calm_frames += state->measured_frames;
+            if (state->calm_frames >= 60 && state->level) {
+                state->level--;
+                state->calm_frames = 0;
+            }
+        }
+        else {
+            state->calm_frames = 0;
+        }
+        if (state->level > state->max_skipped_frames) {
+            state->level = state->max_skipped_frames;
+        }
+        state->measured_nanoseconds = 0;
+        state->measured_frames = 0;
+        state->countdown = state->level;
+    }
+    
+    /* Decide whether the next frame is rendered */
+    if (state->countdown) {
+        if (!gb->disable_rendering) {
+            gb->disable_rendering = true;
+            state->skipping = true;
+        }
+    }
+    else if (state->skipping) {
+        gb->disable_rendering = false;
+        state->skipping = false;
+    }
+    
+    return skipped;
+}
 #else
 
 bool GB_timing_sync_turbo(GB_gameboy_t *gb)
@@ -108,6 +188,11 @@ bool GB_timing_sync_turbo(GB_gameboy_t *gb)
     return false;
 }
 
+bool GB_timing_adaptive_frameskip(GB_gameboy_t *gb)
+{
+    return false;
+}
+
 void GB_timing_sync(GB_gameboy_t *gb)
 {
 #ifndef GB_DISABLE_DEBUGGER
@@ -115,6 +200,10 @@ void GB_timing_sync(GB_gameboy_t *gb)
 #endif
     if (gb->cycles_since_last_sync < LCDC_PERIOD / 3) return;
     gb->cycles_since_last_sync = 0;
+    if (gb->audio_sync_callback && !gb->turbo) {
+        GB_apu_flush_sample_buffer(gb);
+        gb->audio_sync_callback(gb);
+    }
 
     gb->cycles_since_last_sync = 0;
     if (gb->update_input_hint_callback) {
@@ -494,6 +583,9 @@ void GB_advance_cycles(GB_gameboy_t *gb, uint8_t cycles)
     }
     gb->cycles_since_last_sync += cycles;
     gb->cycles_since_run += cycles;
+    if (unlikely(gb->vgm_logger)) {
+        gb->vgm_logger->cycles += cycles;
+    }
     
     gb->rumble_on_cycles += gb->rumble_strength & 3;
     gb->rumble_off_cycles += (gb->rumble_strength & 3) ^ 3;
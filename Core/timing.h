@@ -18,6 +18,7 @@ internal void GB_advance_cycles(GB_gameboy_t *gb, uint8_t cycles);
 internal void GB_emulate_timer_glitch(GB_gameboy_t *gb, uint8_t old_tac, uint8_t new_tac);
 internal bool GB_timing_sync_turbo(GB_gameboy_t *gb); /* Returns true if should skip frame */
 internal void GB_timing_sync(GB_gameboy_t *gb);
+internal bool GB_timing_adaptive_frameskip(GB_gameboy_t *gb); /* Called on vblank, returns true if the frame was skipped */
 internal void GB_set_internal_div_counter(GB_gameboy_t *gb, uint16_t value);
 internal void GB_serial_master_edge(GB_gameboy_t *gb);
 internal void GB_rtc_set_time(GB_gameboy_t *gb, uint64_t time);
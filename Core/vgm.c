@@ -0,0 +1,462 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "gb.h"
+
+#define VGM_SAMPLE_RATE 44100
+#define VGM_VERSION 0x161
+#define VGM_HEADER_SIZE 0x100
+#define VGM_DMG_CLOCK 4194304
+#define VGM_LOOP_TOLERANCE 44 // Samples, timing jitter allowed between matching loop iterations
+#define VGM_MIN_LOOP_SAMPLES (VGM_SAMPLE_RATE * 3) // Shorter repetitions are usually a held note, not a song loop
+#define VGM_MIN_LOOP_EVENTS 16
+
+struct GB_vgm_player_s {
+    size_t size;
+    size_t position;
+    size_t loop_position; // 0 if the file does not loop
+    uint64_t samples; // Playback position, in 44100Hz samples
+    uint64_t cycles; // CPU cycles played
+    uint64_t loop_samples; // Playback position on the last loop, used to detect empty loops
+    bool finished;
+    uint8_t data[];
+};
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t allocated;
+} vgm_buffer_t;
+
+static void log_event(GB_vgm_logger_t *logger, uint8_t reg, uint8_t value)
+{
+    if (logger->count == logger->allocated) {
+        logger->allocated = logger->allocated? logger->allocated * 2 : 0x1000;
+        logger->events = realloc(logger->events, logger->allocated * sizeof(logger->events[0]));
+    }
+    logger->events[logger->count++] = (GB_vgm_event_t){logger->cycles, reg, value};
+}
+
+void GB_vgm_log_write(GB_gameboy_t *gb, uint8_t reg, uint8_t value)
+{
+    log_event(gb->vgm_logger, reg, value);
+}
+
+int GB_start_vgm_logging(GB_gameboy_t *gb, const char *path)
+{
+    if (gb->vgm_logger) {
+        GB_stop_vgm_logging(gb);
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file) return errno;
+
+    GB_vgm_logger_t *logger = calloc(1, sizeof(*logger));
+    logger->file = file;
+    logger->clock_rate = GB_get_unmultiplied_clock_rate(gb) * 2;
+
+    /* Start the log with the current APU state */
+    log_event(logger, GB_IO_NR52, gb->apu.global_enable? 0x80 : 0);
+    for (unsigned i = GB_IO_WAV_START; i <= GB_IO_WAV_END; i++) {
+        log_event(logger, i, gb->io_registers[i]);
+    }
+    if (gb->apu.global_enable) {
+        log_event(logger, GB_IO_NR50, gb->io_registers[GB_IO_NR50]);
+        log_event(logger, GB_IO_NR51, gb->io_registers[GB_IO_NR51]);
+        static const struct {
+            uint8_t first;
+            uint8_t last;
+            uint8_t channel;
+        } channels[] = {
+            {GB_IO_NR10, GB_IO_NR14, GB_SQUARE_1},
+            {GB_IO_NR21, GB_IO_NR24, GB_SQUARE_2},
+            {GB_IO_NR30, GB_IO_NR34, GB_WAVE},
+            {GB_IO_NR41, GB_IO_NR44, GB_NOISE},
+        };
+        for (unsigned i = 0; i < sizeof(channels) / sizeof(channels[0]); i++) {
+            for (unsigned reg = channels[i].first; reg < channels[i].last; reg++) {
+                log_event(logger, reg, gb->io_registers[reg]);
+            }
+            /* Retrigger channels that are currently playing */
+            log_event(logger, channels[i].last, (gb->io_registers[channels[i].last] & 0x7F) |
+                                                (gb->apu.is_active[channels[i].channel]? 0x80 : 0));
+        }
+    }
+
+    gb->vgm_logger = logger;
+    return 0;
+}
+
+bool GB_is_vgm_logging(GB_gameboy_t *gb)
+{
+    return gb->vgm_logger;
+}
+
+static void buffer_append(vgm_buffer_t *buffer, const uint8_t *data, size_t size)
+{
+    if (buffer->size + size > buffer->allocated) {
+        buffer->allocated = MAX(buffer->allocated * 2, buffer->size + size);
+        buffer->data = realloc(buffer->data, buffer->allocated);
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+static void write_le32(uint8_t *data, uint32_t value)
+{
+    data[0] = value;
+    data[1] = value >> 8;
+    data[2] = value >> 16;
+    data[3] = value >> 24;
+}
+
+static uint32_t read_le32(const uint8_t *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static void append_wait(vgm_buffer_t *buffer, uint64_t samples)
+{
+    while (samples) {
+        if (samples == 735) {
+            buffer_append(buffer, (uint8_t []){0x62}, 1);
+            return;
+        }
+        if (samples == 882) {
+            buffer_append(buffer, (uint8_t []){0x63}, 1);
+            return;
+        }
+        if (samples <= 16) {
+            buffer_append(buffer, (uint8_t []){0x6F + samples}, 1);
+            return;
+        }
+        uint16_t chunk = MIN(samples, 0xFFFF);
+        buffer_append(buffer, (uint8_t []){0x61, chunk, chunk >> 8}, 3);
+        samples -= chunk;
+    }
+}
+
+static bool same_key(const GB_vgm_event_t *events, size_t a, size_t b)
+{
+    return events[a].reg == events[b].reg && events[a].value == events[b].value;
+}
+
+static bool events_match(const GB_vgm_event_t *events, const uint32_t *waits, size_t a, size_t b)
+{
+    if (!same_key(events, a, b)) return false;
+    return (waits[a] > waits[b]? waits[a] - waits[b] : waits[b] - waits[a]) <= VGM_LOOP_TOLERANCE;
+}
+
+/* Finds the earliest event sequence that repeats at least twice until the end of the log. A prefix function over
+   the reversed event keys finds the longest periodic suffix in linear time, timing is checked on it afterwards. */
+static bool find_loop(const GB_vgm_event_t *events, const uint32_t *waits, size_t count,
+                      size_t *loop_start, size_t *loop_length)
+{
+    if (count < 2) return false;
+
+    size_t *prefix = malloc(count * sizeof(*prefix));
+    prefix[0] = 0;
+    for (size_t i = 1; i < count; i++) {
+        size_t k = prefix[i - 1];
+        while (k && !same_key(events, count - 1 - i, count - 1 - k)) {
+            k = prefix[k - 1];
+        }
+        if (same_key(events, count - 1 - i, count - 1 - k)) {
+            k++;
+        }
+        prefix[i] = k;
+    }
+
+    /* The longest suffix that contains its shortest period at least twice */
+    size_t length = 0;
+    for (size_t suffix = count; suffix >= 2; suffix--) {
+        size_t period = suffix - prefix[suffix - 1];
+        if (period * 2 <= suffix) {
+            length = period;
+            break;
+        }
+    }
+    free(prefix);
+    if (!length) return false;
+
+    size_t start = count - length;
+    while (start && events_match(events, waits, start - 1, start - 1 + length)) {
+        start--;
+    }
+    if (start + length * 2 > count) return false;
+
+    /* Without two full passes of the song, the only repeating suffix is often a few frames of a sustained note.
+       Looping it would cut the rest of the capture, so the log is better left unlooped. */
+    uint64_t duration = 0;
+    for (size_t i = start; i < start + length; i++) {
+        duration += waits[i];
+    }
+    if (length < VGM_MIN_LOOP_EVENTS || duration < VGM_MIN_LOOP_SAMPLES) return false;
+
+    *loop_start = start;
+    *loop_length = length;
+    return true;
+}
+
+static int write_vgm(GB_vgm_logger_t *logger)
+{
+    size_t count = logger->count;
+    uint64_t *times = malloc((count + 1) * sizeof(*times));
+    uint32_t *waits = malloc((count + 1) * sizeof(*waits));
+    for (size_t i = 0; i <= count; i++) {
+        /* The last entry marks the end of the log */
+        uint64_t cycles = i == count? logger->cycles : logger->events[i].cycles;
+        times[i] = (cycles * VGM_SAMPLE_RATE + logger->clock_rate / 2) / logger->clock_rate;
+        waits[i] = MIN(times[i] - (i? times[i - 1] : 0), UINT32_MAX);
+    }
+
+    size_t loop_start = 0, loop_length = 0;
+    bool loops = find_loop(logger->events, waits, count, &loop_start, &loop_length);
+    if (loops) {
+        count = loop_start + loop_length;
+    }
+
+    vgm_buffer_t buffer = {0,};
+    uint8_t header[VGM_HEADER_SIZE] = {0,};
+    buffer_append(&buffer, header, sizeof(header));
+    size_t loop_offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (loops && i == loop_start) {
+            loop_offset = buffer.size;
+        }
+        append_wait(&buffer, waits[i]);
+        buffer_append(&buffer, (uint8_t []){0xB3, logger->events[i].reg - GB_IO_NR10, logger->events[i].value}, 3);
+    }
+    uint64_t total_samples = times[count - 1];
+    if (!loops) {
+        append_wait(&buffer, waits[count]);
+        total_samples = times[count];
+    }
+    buffer_append(&buffer, (uint8_t []){0x66}, 1);
+
+    memcpy(buffer.data, "Vgm ", 4);
+    write_le32(buffer.data + 0x04, buffer.size - 0x04);
+    write_le32(buffer.data + 0x08, VGM_VERSION);
+    write_le32(buffer.data + 0x18, total_samples);
+    if (loops) {
+        write_le32(buffer.data + 0x1C, loop_offset - 0x1C);
+        write_le32(buffer.data + 0x20, total_samples - (loop_start? times[loop_start - 1] : 0));
+    }
+    write_le32(buffer.data + 0x34, VGM_HEADER_SIZE - 0x34);
+    write_le32(buffer.data + 0x80, VGM_DMG_CLOCK);
+
+    int error = 0;
+    if (fwrite(buffer.data, buffer.size, 1, logger->file) != 1) {
+        error = errno ?: EIO;
+    }
+    free(buffer.data);
+    free(times);
+    free(waits);
+    return error;
+}
+
+int GB_stop_vgm_logging(GB_gameboy_t *gb)
+{
+    GB_vgm_logger_t *logger = gb->vgm_logger;
+    if (!logger) return -1;
+    gb->vgm_logger = NULL;
+
+    int error = write_vgm(logger);
+    if (fclose(logger->file) && !error) {
+        error = errno ?: EIO;
+    }
+    free(logger->events);
+    free(logger);
+    return error;
+}
+
+int GB_load_vgm_from_buffer(GB_gameboy_t *gb, const uint8_t *buffer, size_t size)
+{
+    GB_ASSERT_NOT_RUNNING_OTHER_THREAD(gb)
+
+    if (size < 0x40 || memcmp(buffer, "Vgm ", 4) != 0) {
+        GB_log(gb, "Not a valid VGM file.\n");
+        return -1;
+    }
+
+    uint32_t version = read_le32(buffer + 0x08);
+    if (version < VGM_VERSION || size < 0x84 || !read_le32(buffer + 0x80)) {
+        GB_log(gb, "This VGM file does not contain Game Boy audio.\n");
+        return -1;
+    }
+
+    size_t end = read_le32(buffer + 0x04) + (size_t)0x04;
+    if (end > size) {
+        end = size;
+    }
+    size_t data_offset = read_le32(buffer + 0x34)? read_le32(buffer + 0x34) + (size_t)0x34 : 0x40;
+    size_t loop_offset = read_le32(buffer + 0x1C)? read_le32(buffer + 0x1C) + (size_t)0x1C : 0;
+    if (data_offset >= end) {
+        GB_log(gb, "Not a valid VGM file.\n");
+        return -1;
+    }
+    if (loop_offset < data_offset || loop_offset >= end) {
+        loop_offset = 0;
+    }
+
+    GB_reset(gb);
+    GB_vgm_player_t *player = malloc(sizeof(*player) + end);
+    memset(player, 0, sizeof(*player));
+    memcpy(player->data, buffer, end);
+    player->size = end;
+    player->position = data_offset;
+    player->loop_position = loop_offset;
+    player->loop_samples = UINT64_MAX;
+    gb->vgm_player = player;
+    return 0;
+}
+
+int GB_load_vgm(GB_gameboy_t *gb, const char *path)
+{
+    GB_ASSERT_NOT_RUNNING_OTHER_THREAD(gb)
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        GB_log(gb, "Could not open VGM file: %s.\n", strerror(errno));
+        return errno;
+    }
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    if (length < 0) {
+        int error = errno ?: EIO;
+        GB_log(gb, "Could not read VGM file: %s.\n", strerror(error));
+        fclose(f);
+        return error;
+    }
+    size_t file_size = MIN(length, 0x4000000); // 64MB
+    fseek(f, 0, SEEK_SET);
+    uint8_t *file_data = malloc(file_size);
+    fread(file_data, 1, file_size, f);
+    fclose(f);
+
+    int r = GB_load_vgm_from_buffer(gb, file_data, file_size);
+    free(file_data);
+    return r;
+}
+
+void GB_vgm_player_free(GB_gameboy_t *gb)
+{
+    if (gb->vgm_player) {
+        free(gb->vgm_player);
+        gb->vgm_player = NULL;
+    }
+}
+
+static void run_command(GB_gameboy_t *gb, GB_vgm_player_t *player)
+{
+    const uint8_t *command = player->data + player->position;
+    size_t left = player->size - player->position;
+    size_t length = 1;
+
+    switch (command[0]) {
+        case 0xB3:
+            length = 3;
+            /* Writes to a second Game Boy are ignored */
+            if (left >= length && command[1] <= GB_IO_WAV_END - GB_IO_NR10) {
+                GB_apu_write(gb, command[1] + GB_IO_NR10, command[2]);
+            }
+            break;
+        case 0x61:
+            length = 3;
+            if (left >= length) {
+                player->samples += command[1] | (command[2] << 8);
+            }
+            break;
+        case 0x62:
+            player->samples += 735;
+            break;
+        case 0x63:
+            player->samples += 882;
+            break;
+        case 0x66:
+            /* Stop on loops that take no time, they would never return */
+            if (player->loop_position && player->loop_samples != player->samples) {
+                player->loop_samples = player->samples;
+                player->position = player->loop_position;
+                return;
+            }
+            player->finished = true;
+            return;
+        case 0x67:
+            length = 7;
+            if (left >= length) {
+                length += read_le32(command + 3) & 0x7FFFFFFF;
+            }
+            break;
+        case 0x68: length = 12; break;
+        case 0x70 ... 0x7F:
+            player->samples += command[0] - 0x6F;
+            break;
+        case 0x80 ... 0x8F:
+            player->samples += command[0] & 0xF;
+            break;
+        /* Commands for other chips are skipped */
+        case 0x30 ... 0x3F:
+        case 0x4F:
+        case 0x50:
+        case 0x94:
+            length = 2;
+            break;
+        case 0x40 ... 0x4E:
+        case 0x51 ... 0x5F:
+        case 0xA0 ... 0xB2:
+        case 0xB4 ... 0xBF:
+            length = 3;
+            break;
+        case 0xC0 ... 0xDF:
+            length = 4;
+            break;
+        case 0x90 ... 0x91:
+        case 0x95:
+        case 0xE0 ... 0xFF:
+            length = 5;
+            break;
+        case 0x92: length = 6; break;
+        case 0x93: length = 11; break;
+        default:
+            GB_log(gb, "Unsupported VGM command %02x.\n", command[0]);
+            player->finished = true;
+            return;
+    }
+
+    if (length > left) {
+        player->finished = true;
+        return;
+    }
+    player->position += length;
+}
+
+unsigned GB_vgm_player_run(GB_gameboy_t *gb)
+{
+    GB_vgm_player_t *player = gb->vgm_player;
+    gb->cycles_since_run = 0;
+
+    uint64_t target = 0;
+    while (!player->finished) {
+        /* Keep writes aligned to CPU cycles */
+        target = (player->samples * GB_get_unmultiplied_clock_rate(gb) / VGM_SAMPLE_RATE) & ~3;
+        if (target > player->cycles) break;
+        if (player->position >= player->size) {
+            player->finished = true;
+            break;
+        }
+        run_command(gb, player);
+    }
+
+    /* GB_advance_cycles takes at most 127 cycles in single speed mode */
+    uint8_t cycles = player->finished? 64 : MIN(target - player->cycles, 64);
+    GB_advance_cycles(gb, cycles);
+    player->cycles += cycles;
+
+    /* The PPU is not driven by the player, but frontends still rely on VBlanks to end GB_run_frame, flush the sample
+       buffer and sync. GB_display_vblank resets the counter, so this never doubles up with an LCD-off VBlank. */
+    if (gb->cycles_since_vblank_callback >= LCDC_PERIOD) {
+        GB_display_vblank(gb, GB_VBLANK_TYPE_LCD_OFF);
+    }
+    return gb->cycles_since_run;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "defs.h"
+
+typedef struct GB_vgm_logger_s GB_vgm_logger_t;
+typedef struct GB_vgm_player_s GB_vgm_player_t;
+
+#ifdef GB_INTERNAL
+typedef struct {
+    uint64_t cycles; // 8MHz ticks since logging started
+    uint8_t reg;
+    uint8_t value;
+} GB_vgm_event_t;
+
+struct GB_vgm_logger_s {
+    FILE *file;
+    uint64_t cycles; // 8MHz ticks, advanced by GB_advance_cycles
+    unsigned clock_rate; // 8MHz ticks per second
+    GB_vgm_event_t *events;
+    size_t count;
+    size_t allocated;
+};
+
+internal void GB_vgm_log_write(GB_gameboy_t *gb, uint8_t reg, uint8_t value);
+internal unsigned GB_vgm_player_run(GB_gameboy_t *gb);
+internal void GB_vgm_player_free(GB_gameboy_t *gb);
+#endif
+
+/* Logs APU and wave RAM writes to a VGM file, which is a tiny fraction of the size of a PCM recording. Logging
+   for at least two loops of a song lets GB_stop_vgm_logging detect its loop point, loops shorter than 3 seconds are
+   ignored. Returns 0 or an errno value. */
+int GB_start_vgm_logging(GB_gameboy_t *gb, const char *path);
+int GB_stop_vgm_logging(GB_gameboy_t *gb);
+bool GB_is_vgm_logging(GB_gameboy_t *gb);
+
+/* Resets the emulator and plays a VGM file's Game Boy writes through the APU. While loaded, GB_run advances the
+   APU and timers without running the CPU or PPU. Playback ends on the next reset. */
+int GB_load_vgm(GB_gameboy_t *gb, const char *path);
+int GB_load_vgm_from_buffer(GB_gameboy_t *gb, const uint8_t *buffer, size_t size);
@@ -85,6 +85,12 @@ void GB_audio_queue_sample(GB_sample_t *sample)
     return driver->audio_queue_sample(sample);
 }
 
+void GB_audio_queue_samples(GB_sample_t *samples, size_t count)
+{
+    if (unlikely(!driver)) return;
+    return driver->audio_queue_samples(samples, count);
+}
+
 const char *GB_audio_driver_name(void)
 {
     if (unlikely(!driver)) return "None";
@@ -10,6 +10,7 @@ void GB_audio_clear_queue(void);
 unsigned GB_audio_get_frequency(void);
 size_t GB_audio_get_queue_length(void);
 void GB_audio_queue_sample(GB_sample_t *sample);
+void GB_audio_queue_samples(GB_sample_t *samples, size_t count);
 bool GB_audio_init(void);
 void GB_audio_deinit(void);
 const char *GB_audio_driver_name(void);
@@ -22,6 +23,7 @@ typedef struct {
     typeof(GB_audio_get_frequency) *audio_get_frequency;
     typeof(GB_audio_get_queue_length) *audio_get_queue_length;
     typeof(GB_audio_queue_sample) *audio_queue_sample;
+    typeof(GB_audio_queue_samples) *audio_queue_samples;
     typeof(GB_audio_init) *audio_init;
     typeof(GB_audio_deinit) *audio_deinit;
     const char *name;
@@ -34,6 +36,7 @@ typedef struct {
     .audio_get_frequency = _audio_get_frequency, \
     .audio_get_queue_length = _audio_get_queue_length, \
     .audio_queue_sample = _audio_queue_sample, \
+    .audio_queue_samples = _audio_queue_samples, \
     .audio_init = _audio_init, \
     .audio_deinit = _audio_deinit, \
     .name = #_name, \
@@ -226,6 +226,13 @@ static void _audio_queue_sample(GB_sample_t *sample)
     }
 }
 
+static void _audio_queue_samples(GB_sample_t *samples, size_t count)
+{
+    while (count--) {
+        _audio_queue_sample(samples++);
+    }
+}
+
 static bool _audio_init(void)
 {
     // Open the default device
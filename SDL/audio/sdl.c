@@ -1,5 +1,6 @@
 #include "audio.h"
 #include <SDL.h>
+#include <string.h>
 
 #ifndef _WIN32
 #define AUDIO_FREQUENCY 96000
@@ -25,9 +26,34 @@
 static SDL_AudioDeviceID device_id;
 static SDL_AudioSpec want_aspec, have_aspec;
 
-#define AUDIO_BUFFER_SIZE 512
-static unsigned buffer_pos = 0;
-static GB_sample_t audio_buffer[AUDIO_BUFFER_SIZE];
+/* Single-producer, single-consumer ring between the emulation thread and SDL's audio callback. Each position is only
+   written by one side, and only ever increases. */
+#define AUDIO_RING_SIZE 0x4000 // Must be a power of two
+static GB_sample_t ring[AUDIO_RING_SIZE];
+static size_t ring_read, ring_write;
+static GB_sample_t last_sample;
+
+static void audio_callback(void *userdata, Uint8 *stream, int length)
+{
+    GB_sample_t *output = (GB_sample_t *)stream;
+    size_t count = length / sizeof(*output);
+    size_t read = ring_read;
+    size_t available = __atomic_load_n(&ring_write, __ATOMIC_ACQUIRE) - read;
+    size_t copied = MIN(count, available);
+    
+    size_t first_run = MIN(copied, AUDIO_RING_SIZE - (read & (AUDIO_RING_SIZE - 1)));
+    memcpy(output, ring + (read & (AUDIO_RING_SIZE - 1)), first_run * sizeof(*output));
+    memcpy(output + first_run, ring, (copied - first_run) * sizeof(*output));
+    __atomic_store_n(&ring_read, read + copied, __ATOMIC_RELEASE);
+    
+    if (copied) {
+        last_sample = output[copied - 1];
+    }
+    /* On underrun, hold the last sample rather than dropping to silence, which would click */
+    for (size_t i = copied; i < count; i++) {
+        output[i] = last_sample;
+    }
+}
 
 static bool _audio_is_playing(void)
 {
@@ -36,7 +62,9 @@ static bool _audio_is_playing(void)
 
 static void _audio_clear_queue(void)
 {
-    SDL_ClearQueuedAudio(device_id);
+    SDL_LockAudioDevice(device_id);
+    ring_read = ring_write;
+    SDL_UnlockAudioDevice(device_id);
 }
 
 static void _audio_set_paused(bool paused)
@@ -52,17 +80,24 @@ static unsigned _audio_get_frequency(void)
 
 static size_t _audio_get_queue_length(void)
 {
-    return SDL_GetQueuedAudioSize(device_id) / sizeof(GB_sample_t);
+    return ring_write - __atomic_load_n(&ring_read, __ATOMIC_ACQUIRE);
 }
 
-static void _audio_queue_sample(GB_sample_t *sample)
+static void _audio_queue_samples(GB_sample_t *samples, size_t count)
 {
-    audio_buffer[buffer_pos++] = *sample;
+    size_t write = ring_write;
+    size_t space = AUDIO_RING_SIZE - (write - __atomic_load_n(&ring_read, __ATOMIC_ACQUIRE));
+    count = MIN(count, space); // Drop what doesn't fit
+    
+    size_t first_run = MIN(count, AUDIO_RING_SIZE - (write & (AUDIO_RING_SIZE - 1)));
+    memcpy(ring + (write & (AUDIO_RING_SIZE - 1)), samples, first_run * sizeof(*samples));
+    memcpy(ring, samples + first_run, (count - first_run) * sizeof(*samples));
+    __atomic_store_n(&ring_write, write + count, __ATOMIC_RELEASE);
+}
 
-    if (buffer_pos == AUDIO_BUFFER_SIZE) {
-        buffer_pos = 0;
-        SDL_QueueAudio(device_id, (const void *)audio_buffer, sizeof(audio_buffer));
-    }
+static void _audio_queue_sample(GB_sample_t *sample)
+{
+    _audio_queue_samples(sample, 1);
 }
 
 static bool _audio_init(void)
@@ -78,6 +113,7 @@ static bool _audio_init(void)
     want_aspec.format = AUDIO_S16SYS;
     want_aspec.channels = 2;
     want_aspec.samples = 512;
+    want_aspec.callback = audio_callback;
     
     SDL_version _sdl_version;
     SDL_GetVersion(&_sdl_version);
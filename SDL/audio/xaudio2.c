@@ -126,6 +126,13 @@ static void _audio_queue_sample(GB_sample_t *sample)
     }
 }
 
+static void _audio_queue_samples(GB_sample_t *samples, size_t count)
+{
+    while (count--) {
+        _audio_queue_sample(samples++);
+    }
+}
+
 static bool _audio_init(void)
 {
     HRESULT hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
@@ -168,6 +168,9 @@ typedef struct {
         
         /* v1.0.3 */
         uint8_t rumble_strength;
+        
+        /* v1.0.4 */
+        bool sync_to_audio;
     };
 } configuration_t;
 
@@ -45,33 +45,72 @@ static unsigned factor;
 
 static SDL_Surface *converted_background = NULL;
 
+/* Without OpenGL, filters with a CPU implementation are applied before uploading, into a larger texture */
+static SDL_Texture *scaled_texture = NULL;
+static unsigned scaled_texture_width, scaled_texture_height;
+static bool showing_scaled_texture = false;
+
 bool screen_manually_resized = false;
 
 void render_texture(void *pixels,  void *previous)
 {
+    GB_frame_blending_mode_t mode = configuration.blending_mode;
+    if (!previous) {
+        mode = GB_FRAME_BLENDING_MODE_DISABLED;
+    }
+    else {
+        mode = GB_get_effective_frame_blending_mode(&gb, mode);
+    }
     if (renderer) {
         if (pixels) {
-            SDL_UpdateTexture(texture, NULL, pixels, GB_get_screen_width(&gb) * sizeof (uint32_t));
+            if (mode != GB_FRAME_BLENDING_MODE_DISABLED) {
+                static uint32_t blended[256 * 224];
+                GB_blend_frames(&gb, blended, pixels, previous, mode);
+                pixels = blended;
+            }
+            unsigned width = GB_get_screen_width(&gb);
+            unsigned height = GB_get_screen_height(&gb);
+            GB_scaler_t scaler;
+            showing_scaled_texture = GB_get_scaler_by_name(configuration.filter, &scaler) &&
+                                     scaler != GB_SCALER_NEAREST_NEIGHBOR;
+            if (showing_scaled_texture) {
+                unsigned scale = GB_get_scaler_factor(scaler);
+                if (scaler == GB_SCALER_OMNISCALE) {
+                    scale = rect.w / width;
+                    if (scale < 2) scale = 2;
+                    if (scale > 8) scale = 8;
+                }
+                static uint32_t *scaled_pixels = NULL;
+                static size_t scaled_pixels_size = 0;
+                size_t size = width * scale * height * scale * sizeof(uint32_t);
+                if (size > scaled_pixels_size) {
+                    scaled_pixels = realloc(scaled_pixels, size);
+                    scaled_pixels_size = size;
+                }
+                GB_scale_image(scaler, scaled_pixels, pixels, width, height, scale,
+                               GB_get_pixel_channels(&gb), SDL_GetCPUCount());
+                if (!scaled_texture || scaled_texture_width != width * scale || scaled_texture_height != height * scale) {
+                    if (scaled_texture) {
+                        SDL_DestroyTexture(scaled_texture);
+                    }
+                    scaled_texture_width = width * scale;
+                    scaled_texture_height = height * scale;
+                    scaled_texture = SDL_CreateTexture(renderer, SDL_GetWindowPixelFormat(window), SDL_TEXTUREACCESS_STREAMING,
+                                                       scaled_texture_width, scaled_texture_height);
+                }
+                SDL_UpdateTexture(scaled_texture, NULL, scaled_pixels, scaled_texture_width * sizeof (uint32_t));
+            }
+            else {
+                SDL_UpdateTexture(texture, NULL, pixels, width * sizeof (uint32_t));
+            }
         }
         SDL_RenderClear(renderer);
-        SDL_RenderCopy(renderer, texture, NULL, NULL);
+        SDL_RenderCopy(renderer, showing_scaled_texture? scaled_texture : texture, NULL, NULL);
         SDL_RenderPresent(renderer);
     }
     else {
         glClearColor(0, 0, 0, 1);
         glClear(GL_COLOR_BUFFER_BIT);
-        GB_frame_blending_mode_t mode = configuration.blending_mode;
-        if (!previous) {
-            mode = GB_FRAME_BLENDING_MODE_DISABLED;
-        }
-        else if (mode == GB_FRAME_BLENDING_MODE_ACCURATE) {
-            if (GB_is_sgb(&gb)) {
-                mode = GB_FRAME_BLENDING_MODE_SIMPLE;
-            }
-            else {
-                mode = GB_is_odd_frame(&gb)? GB_FRAME_BLENDING_MODE_ACCURATE_ODD : GB_FRAME_BLENDING_MODE_ACCURATE_EVEN;
-            }
-        }
         render_bitmap_with_shader(&shader, pixels, previous,
                                   GB_get_screen_width(&gb), GB_get_screen_height(&gb),
                                   rect.x, rect.y, rect.w, rect.h,
@@ -1547,9 +1586,14 @@ struct shader_name {
     {"AAOmniScaleLegacy", "AA OmniScale Legacy"},
 };
 
+static bool filter_available(unsigned i)
+{
+    GB_scaler_t scaler;
+    return uses_gl() || GB_get_scaler_by_name(shaders[i].file_name, &scaler);
+}
+
 static void cycle_filter(unsigned index)
 {
-    if (!uses_gl()) return;
     unsigned i = 0;
     for (; i < sizeof(shaders) / sizeof(shaders[0]); i++) {
         if (strcmp(shaders[i].file_name, configuration.filter) == 0) {
@@ -1557,11 +1601,12 @@ static void cycle_filter(unsigned index)
         }
     }
     
-
-    i += 1;
-    if (i >= sizeof(shaders) / sizeof(shaders[0])) {
-        i -= sizeof(shaders) / sizeof(shaders[0]);
-    }
+    do {
+        i += 1;
+        if (i >= sizeof(shaders) / sizeof(shaders[0])) {
+            i -= sizeof(shaders) / sizeof(shaders[0]);
+        }
+    } while (!filter_available(i));
     
     strcpy(configuration.filter, shaders[i].file_name);
     free_shader(&shader);
@@ -1572,7 +1617,6 @@ static void cycle_filter(unsigned index)
 
 static void cycle_filter_backwards(unsigned index)
 {
-    if (!uses_gl()) return;
     unsigned i = 0;
     for (; i < sizeof(shaders) / sizeof(shaders[0]); i++) {
         if (strcmp(shaders[i].file_name, configuration.filter) == 0) {
@@ -1580,10 +1624,12 @@ static void cycle_filter_backwards(unsigned index)
         }
     }
     
-    i -= 1;
-    if (i >= sizeof(shaders) / sizeof(shaders[0])) {
-        i = sizeof(shaders) / sizeof(shaders[0]) - 1;
-    }
+    do {
+        i -= 1;
+        if (i >= sizeof(shaders) / sizeof(shaders[0])) {
+            i = sizeof(shaders) / sizeof(shaders[0]) - 1;
+        }
+    } while (!filter_available(i));
     
     strcpy(configuration.filter, shaders[i].file_name);
     free_shader(&shader);
@@ -1594,7 +1640,6 @@ static void cycle_filter_backwards(unsigned index)
 }
 static const char *current_filter_name(unsigned index)
 {
-    if (!uses_gl()) return "Requires OpenGL 3.2+";
     unsigned i = 0;
     for (; i < sizeof(shaders) / sizeof(shaders[0]); i++) {
         if (strcmp(shaders[i].file_name, configuration.filter) == 0) {
@@ -1606,12 +1651,13 @@ static const char *current_filter_name(unsigned index)
         i = 0;
     }
     
+    if (!filter_available(i)) return "Requires OpenGL 3.2+";
+    
     return shaders[i].display_name;
 }
 
 static void cycle_blending_mode(unsigned index)
 {
-        if (!uses_gl()) return;
     if (configuration.blending_mode == GB_FRAME_BLENDING_MODE_ACCURATE) {
         configuration.blending_mode = GB_FRAME_BLENDING_MODE_DISABLED;
     }
@@ -1622,7 +1668,6 @@ static void cycle_blending_mode(unsigned index)
 
 static void cycle_blending_mode_backwards(unsigned index)
 {
-    if (!uses_gl()) return;
     if (configuration.blending_mode == GB_FRAME_BLENDING_MODE_DISABLED) {
         configuration.blending_mode = GB_FRAME_BLENDING_MODE_ACCURATE;
     }
@@ -1633,7 +1678,6 @@ static void cycle_blending_mode_backwards(unsigned index)
 
 static const char *blending_mode_string(unsigned index)
 {
-    if (!uses_gl()) return "Requires OpenGL 3.2+";
     return GB_inline_const(const char *[], {"Disabled", "Simple", "Accurate"})
         [configuration.blending_mode];
 }
@@ -1823,6 +1867,16 @@ static void decrease_interference_volume(unsigned index)
     }
 }
 
+static const char *sync_to_audio_string(unsigned index)
+{
+    return configuration.sync_to_audio? "Audio Device" : "System Clock";
+}
+
+static void toggle_sync_to_audio(unsigned index)
+{
+    configuration.sync_to_audio ^= true;
+}
+
 static const char *audio_driver_string(unsigned index)
 {
     return GB_audio_driver_name();
@@ -1894,6 +1948,7 @@ static struct menu_item audio_menu[] = {
     {"Highpass Filter:", cycle_highpass_filter, highpass_filter_string, cycle_highpass_filter_backwards},
     {"Volume:", increase_volume, volume_string, decrease_volume},
     {"Interference Volume:", increase_interference_volume, interference_volume_string, decrease_interference_volume},
+    {"Sync Speed To:", toggle_sync_to_audio, sync_to_audio_string, toggle_sync_to_audio},
     {"Preferred Audio Driver:", cycle_prefrered_audio_driver, preferred_audio_driver_string, cycle_preferred_audio_driver_backwards},
     {"Active Driver:", nop, audio_driver_string},
     {"Back", enter_options_menu},
@@ -1902,8 +1957,8 @@ static struct menu_item audio_menu[] = {
 
 static void audio_driver_changed(void)
 {
-    audio_menu[4].value_getter = NULL;
-    audio_menu[4].string = "Relaunch to apply";
+    audio_menu[5].value_getter = NULL;
+    audio_menu[5].string = "Relaunch to apply";
 }
 
 static void enter_audio_menu(unsigned index)
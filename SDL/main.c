@@ -259,6 +259,19 @@ static void screen_size_changed(bool resize_window)
     update_viewport();
 }
 
+static bool audio_sync(GB_gameboy_t *gb)
+{
+    if (!GB_audio_is_playing()) return false;
+    /* Keep about 2 frames queued */
+    size_t target = GB_audio_get_frequency() / 30;
+    unsigned timeout = 100;
+    while (GB_audio_get_queue_length() > target) {
+        if (!timeout--) return false; // The device stalled, fall back to the system clock
+        SDL_Delay(1);
+    }
+    return true;
+}
+
 static void open_menu(void)
 {
     bool audio_playing = GB_audio_is_playing();
@@ -282,6 +295,7 @@ static void open_menu(void)
     GB_set_rewind_length(&gb, configuration.rewind_length);
     GB_set_rtc_mode(&gb, configuration.rtc_mode);
     GB_set_turbo_cap(&gb, configuration.turbo_cap / 4.0);
+    GB_set_audio_sync_callback(&gb, configuration.sync_to_audio? audio_sync : NULL);
     if (previous_width != GB_get_screen_width(&gb)) {
         signed current_window_width, current_window_height;
         SDL_GetWindowSize(window, &current_window_width, &current_window_height);
@@ -815,38 +829,66 @@ static void debugger_reset(int ignore)
 }
 #endif
 
-static void gb_audio_callback(GB_gameboy_t *gb, GB_sample_t *sample)
+static GB_sample_t audio_block[0x200];
+
+static signed audio_rate_adjustment = 0; // In 0.1% steps
+
+static void gb_audio_callback(GB_gameboy_t *gb, GB_sample_t *samples, size_t count)
 {
+    unsigned frequency = GB_audio_get_frequency();
     if (turbo_down) {
         static unsigned skip = 0;
-        skip++;
-        if (skip == GB_audio_get_frequency() / 8) {
-            skip = 0;
-        }
-        if (configuration.turbo_cap) {
-            if (skip > GB_audio_get_frequency() / 8 * 4 / configuration.turbo_cap) {
-                return;
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            skip++;
+            if (skip == frequency / 8) {
+                skip = 0;
             }
-        }
-        else {
-
-            if (skip > GB_audio_get_frequency() / 16) {
-                return;
+            if (configuration.turbo_cap) {
+                if (skip > frequency / 8 * 4 / configuration.turbo_cap) {
+                    continue;
+                }
+            }
+            else {
+                if (skip > frequency / 16) {
+                    continue;
+                }
             }
+            samples[kept++] = samples[i];
         }
+        count = kept;
     }
     
-    if (GB_audio_get_queue_length() > GB_audio_get_frequency() / 8) { // Maximum lag of 0.125s
+    size_t queued = GB_audio_get_queue_length();
+    if (queued > frequency / 8) { // Maximum lag of 0.125s
         return;
     }
     
-    if (configuration.volume != 100) {
-        sample->left = sample->left * configuration.volume / 100;
-        sample->right = sample->right * configuration.volume / 100;
+    if (!turbo_down) {
+        /* Dynamic rate control: nudge the emulated sample rate by up to 0.5% to keep the queue around 20ms, so the
+           audio and video clocks drifting apart doesn't end in underruns or dropped samples. The adjustment is
+           quantized to 0.1% steps so the rate is only changed occasionally. Not needed when emulation is paced by
+           the audio device itself. */
+        signed adjustment = 0;
+        if (!configuration.sync_to_audio) {
+            signed target = frequency / 50;
+            double error = ((signed)queued - target) / (double)target;
+            adjustment = round(MAX(-1.0, MIN(error, 1.0)) * -5);
+        }
+        if (adjustment != audio_rate_adjustment) {
+            audio_rate_adjustment = adjustment;
+            GB_set_sample_rate_by_clocks(gb, GB_get_clock_rate(gb) * 2.0 / (frequency * (1 + adjustment / 1000.0)));
+        }
     }
     
-    GB_audio_queue_sample(sample);
+    if (configuration.volume != 100) {
+        for (size_t i = 0; i < count; i++) {
+            samples[i].left = samples[i].left * configuration.volume / 100;
+            samples[i].right = samples[i].right * configuration.volume / 100;
+        }
+    }
     
+    GB_audio_queue_samples(samples, count);
 }
 
 #ifdef _WIN32
@@ -1172,6 +1214,7 @@ restart:;
         GB_set_rumble_callback(&gb, rumble);
         GB_set_rumble_mode(&gb, configuration.rumble_mode);
         GB_set_sample_rate(&gb, GB_audio_get_frequency());
+        audio_rate_adjustment = 0;
         GB_set_color_correction_mode(&gb, configuration.color_correction_mode);
         GB_set_light_temperature(&gb, (configuration.color_temperature - 10.0) / 10.0);
         GB_set_interference_volume(&gb, configuration.interference_volume / 100.0);
@@ -1183,8 +1226,9 @@ restart:;
         GB_set_rewind_length(&gb, configuration.rewind_length);
         GB_set_rtc_mode(&gb, configuration.rtc_mode);
         GB_set_turbo_cap(&gb, configuration.turbo_cap / 4.0);
+        GB_set_audio_sync_callback(&gb, configuration.sync_to_audio? audio_sync : NULL);
         GB_set_update_input_hint_callback(&gb, handle_events);
-        GB_apu_set_sample_callback(&gb, gb_audio_callback);
+        GB_apu_set_sample_buffer(&gb, audio_block, sizeof(audio_block) / sizeof(audio_block[0]), gb_audio_callback);
         
         if (console_supported) {
             configure_console();
@@ -1277,11 +1321,8 @@ restart:;
         }
         else {
             if (do_rewind) {
-                GB_rewind_pop(&gb);
-                if (turbo_down) {
-                    GB_rewind_pop(&gb);
-                }
-                if (!GB_rewind_pop(&gb)) {
+                unsigned frames = turbo_down? 3 : 2;
+                if (GB_rewind_seek(&gb, frames) < frames) {
                     rewind_paused = true;
                 }
                 do_rewind = false;
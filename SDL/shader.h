@@ -2,6 +2,7 @@
 
 #include "opengl_compat.h"
 #include <stdbool.h>
+#include <Core/gb.h>
 
 typedef struct shader_s {
     GLuint resolution_uniform;
@@ -16,14 +17,6 @@ typedef struct shader_s {
     GLuint program;
 } shader_t;
 
-typedef enum {
-    GB_FRAME_BLENDING_MODE_DISABLED,
-    GB_FRAME_BLENDING_MODE_SIMPLE,
-    GB_FRAME_BLENDING_MODE_ACCURATE,
-    GB_FRAME_BLENDING_MODE_ACCURATE_EVEN = GB_FRAME_BLENDING_MODE_ACCURATE,
-    GB_FRAME_BLENDING_MODE_ACCURATE_ODD,
-} GB_frame_blending_mode_t;
-
 bool init_shader_with_name(shader_t *shader, const char *name);
 void render_bitmap_with_shader(shader_t *shader, void *bitmap, void *previous,
                                unsigned source_width, unsigned source_height,
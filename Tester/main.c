@@ -33,6 +33,9 @@ GB_gameboy_t gb;
 
 static unsigned int frames = 0;
 static bool use_tga = false;
+static bool blend_frames = false;
+static bool use_scaler = false;
+static GB_scaler_t scaler;
 static uint8_t bmp_header[] = {
     0x42, 0x4D, 0x48, 0x68, 0x01, 0x00, 0x00, 0x00,
     0x00, 0x00, 0x46, 0x00, 0x00, 0x00, 0x38, 0x00,
@@ -52,6 +55,8 @@ static uint8_t tga_header[] = {
 };
 
 uint32_t bitmap[256*224];
+static uint32_t previous_bitmap[256*224];
+static bool has_previous_bitmap = false;
 
 static char *async_input_callback(GB_gameboy_t *gb)
 {
@@ -161,22 +166,42 @@ static void vblank(GB_gameboy_t *gb, GB_vblank_type_t type)
         
         /* Let the test run for extra four seconds if the screen is off/disabled */
         if (!is_screen_blank || frames >= test_length + 60 * 4) {
+            uint32_t *output = bitmap;
+            if (blend_frames && has_previous_bitmap) {
+                /* This is the last frame, so it can be blended in place */
+                GB_blend_frames(gb, bitmap, bitmap, previous_bitmap,
+                                GB_get_effective_frame_blending_mode(gb, GB_FRAME_BLENDING_MODE_ACCURATE));
+            }
+            
+            unsigned width = GB_get_screen_width(gb);
+            unsigned height = GB_get_screen_height(gb);
+            uint32_t *scaled = NULL;
+            if (use_scaler) {
+                unsigned factor = GB_get_scaler_factor(scaler);
+                scaled = malloc(sizeof(scaled[0]) * width * height * factor * factor);
+                GB_scale_image(scaler, scaled, output, width, height, factor, GB_get_pixel_channels(gb), 1);
+                output = scaled;
+                width *= factor;
+                height *= factor;
+            }
+            
             FILE *f = fopen(bmp_filename, "wb");
             if (use_tga) {
-                tga_header[0xC] = GB_get_screen_width(gb);
-                tga_header[0xD] = GB_get_screen_width(gb) >> 8;
-                tga_header[0xE] = GB_get_screen_height(gb);
-                tga_header[0xF] = GB_get_screen_height(gb) >> 8;
+                tga_header[0xC] = width;
+                tga_header[0xD] = width >> 8;
+                tga_header[0xE] = height;
+                tga_header[0xF] = height >> 8;
                 fwrite(&tga_header, 1, sizeof(tga_header), f);
             }
             else {
-                (*(uint32_t *)&bmp_header[0x2]) = sizeof(bmp_header) + sizeof(bitmap[0]) * GB_get_screen_width(gb) * GB_get_screen_height(gb) + 2;
-                (*(uint32_t *)&bmp_header[0x12]) = GB_get_screen_width(gb);
-                (*(int32_t *)&bmp_header[0x16]) = -GB_get_screen_height(gb);
-                (*(uint32_t *)&bmp_header[0x22]) = sizeof(bitmap[0]) * GB_get_screen_width(gb) * GB_get_screen_height(gb) + 2;
+                (*(uint32_t *)&bmp_header[0x2]) = sizeof(bmp_header) + sizeof(bitmap[0]) * width * height + 2;
+                (*(uint32_t *)&bmp_header[0x12]) = width;
+                (*(int32_t *)&bmp_header[0x16]) = -height;
+                (*(uint32_t *)&bmp_header[0x22]) = sizeof(bitmap[0]) * width * height + 2;
                 fwrite(&bmp_header, 1, sizeof(bmp_header), f);
             }
-            fwrite(&bitmap, 1, sizeof(bitmap[0]) * GB_get_screen_width(gb) * GB_get_screen_height(gb), f);
+            fwrite(output, 1, sizeof(bitmap[0]) * width * height, f);
+            free(scaled);
             fclose(f);
             if (!gb->boot_rom_finished) {
                 GB_log(gb, "Boot ROM did not finish.\n");
@@ -193,6 +218,11 @@ static void vblank(GB_gameboy_t *gb, GB_vblank_type_t type)
     else if (frames >= test_length - 1) {
         gb->disable_rendering = false;
     }
+    
+    if (running && blend_frames && !gb->disable_rendering) {
+        memcpy(previous_bitmap, bitmap, sizeof(bitmap[0]) * GB_get_screen_width(gb) * GB_get_screen_height(gb));
+        has_previous_bitmap = true;
+    }
 }
 
 static void log_callback(GB_gameboy_t *gb, const char *string, GB_log_attributes_t attributes)
@@ -291,7 +321,7 @@ int main(int argc, char **argv)
     fprintf(stderr, "SameBoy Tester v" GB_VERSION "\n");
 
     if (argc == 1) {
-        fprintf(stderr, "Usage: %s [--dmg] [--sgb] [--cgb] [--start] [--length seconds] [--sav] [--boot path to boot ROM]"
+        fprintf(stderr, "Usage: %s [--dmg] [--sgb] [--cgb] [--blend] [--scale filter] [--start] [--length seconds] [--sav] [--boot path to boot ROM]"
 #ifndef _WIN32
                         " [--jobs number of tests to run simultaneously]"
 #endif
@@ -339,6 +369,22 @@ int main(int argc, char **argv)
             continue;
         }
 
+        if (strcmp(argv[i], "--blend") == 0) {
+            fprintf(stderr, "Blending the output with the previous frame\n");
+            blend_frames = true;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--scale") == 0 && i != argc - 1) {
+            if (!GB_get_scaler_by_name(argv[++i], &scaler)) {
+                fprintf(stderr, "Unsupported scaling filter %s\n", argv[i]);
+                exit(1);
+            }
+            fprintf(stderr, "Scaling the output with %s\n", argv[i]);
+            use_scaler = true;
+            continue;
+        }
+        
         if (strcmp(argv[i], "--start") == 0) {
             fprintf(stderr, "Pushing Start and A\n");
             push_start_a = true;
@@ -500,6 +546,7 @@ int main(int argc, char **argv)
         running = true;
         gb.turbo = gb.turbo_dont_skip = gb.disable_rendering = true;
         frames = 0;
+        has_previous_bitmap = false;
         unsigned cycles = 0;
         while (running) {
             cycles += GB_run(&gb);
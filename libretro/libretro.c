@@ -75,7 +75,6 @@ static bool auto_sgb_enabled[2] = {
 };
 
 static uint32_t *frame_buf = NULL;
-static uint32_t *frame_buf_copy = NULL;
 static uint32_t retained_frame_1[256 * 224];
 static uint32_t retained_frame_2[256 * 224];
 static struct retro_log_callback logging;
@@ -103,6 +102,9 @@ static struct {
     uint32_t capacity;
 } output_audio_buffer = {NULL, 0, 0};
 
+#define AUDIO_BLOCK_SIZE 0x800
+static GB_sample_t audio_blocks[2][AUDIO_BLOCK_SIZE];
+
 char retro_system_directory[4096];
 
 GB_gameboy_t gameboy[2];
@@ -223,48 +225,77 @@ static void upload_output_audio_buffer()
     }
 }
 
-static void audio_callback(GB_gameboy_t *gb, GB_sample_t *sample)
+static void mix_audio_sample(unsigned index, const GB_sample_t *sample)
+{
+    if (output_audio_buffer.sizes[index] < output_audio_buffer.sizes[!index]) {
+        // We're the second instance to reach this sample, add and divide (To prevent overflow)
+        output_audio_buffer.data[output_audio_buffer.sizes[index]] =
+            (output_audio_buffer.data[output_audio_buffer.sizes[index]] + (signed)sample->left) / 2;
+        output_audio_buffer.sizes[index]++;
+        
+        output_audio_buffer.data[output_audio_buffer.sizes[index]] =
+            (output_audio_buffer.data[output_audio_buffer.sizes[index]] + (signed)sample->right) / 2;
+        output_audio_buffer.sizes[index]++;
+    }
+    else {
+        // We're the first instance, set its contents
+        output_audio_buffer.data[output_audio_buffer.sizes[index]++] = sample->left;
+        output_audio_buffer.data[output_audio_buffer.sizes[index]++] = sample->right;
+    }
+}
+
+static void audio_callback(GB_gameboy_t *gb, GB_sample_t *samples, size_t count)
 {
     unsigned index = 0;
     if (gb == &gameboy[1]) {
         index = 1;
     }
     
-    if (output_audio_buffer.capacity - MAX(output_audio_buffer.sizes[0], output_audio_buffer.sizes[1]) < 2) {
-        ensure_output_audio_buffer_capacity(output_audio_buffer.capacity * 1.5);
+    uint32_t needed_capacity = MAX(output_audio_buffer.sizes[0], output_audio_buffer.sizes[1]) + count * 2;
+    if (output_audio_buffer.capacity < needed_capacity) {
+        ensure_output_audio_buffer_capacity(MAX(needed_capacity, output_audio_buffer.capacity * 1.5));
     }
     
     if ((index == 0 && audio_out == AUDIO_OUT_GB_1) ||
         (index == 1 && audio_out == AUDIO_OUT_GB_2)) {
-        output_audio_buffer.data[output_audio_buffer.sizes[0]++] = sample->left;
-        output_audio_buffer.data[output_audio_buffer.sizes[0]++] = sample->right;
+        memcpy(output_audio_buffer.data + output_audio_buffer.sizes[0], samples, count * sizeof(*samples));
+        output_audio_buffer.sizes[0] += count * 2;
         output_audio_buffer.sizes[1] = output_audio_buffer.sizes[0];
     }
     else if (audio_out == AUDIO_OUT_BOTH) {
-        if (output_audio_buffer.sizes[index] < output_audio_buffer.sizes[!index]) {
-            // We're the second instance to reach this sample, add and divide (To prevent overflow)
-            output_audio_buffer.data[output_audio_buffer.sizes[index]] =
-                (output_audio_buffer.data[output_audio_buffer.sizes[index]] + (signed)sample->left) / 2;
-            output_audio_buffer.sizes[index]++;
-            
-            output_audio_buffer.data[output_audio_buffer.sizes[index]] =
-                (output_audio_buffer.data[output_audio_buffer.sizes[index]] + (signed)sample->right) / 2;
-            output_audio_buffer.sizes[index]++;
-        }
-        else {
-            // We're the first instance, set its contents
-            output_audio_buffer.data[output_audio_buffer.sizes[index]++] = sample->left;
-            output_audio_buffer.data[output_audio_buffer.sizes[index]++] = sample->right;
+        for (size_t i = 0; i < count; i++) {
+            mix_audio_sample(index, &samples[i]);
         }
     }
 }
 
+/* The pixels output may be interleaved with the other device's, so frames are copied row by row */
+static void retain_frame(GB_gameboy_t *gb, uint32_t *retained)
+{
+    unsigned width = GB_get_screen_width(gb);
+    unsigned height = GB_get_screen_height(gb);
+    unsigned pitch = GB_get_screen_pitch(gb);
+    const uint32_t *output = GB_get_pixels_output(gb);
+    for (unsigned y = 0; y < height; y++) {
+        memcpy(retained + y * width, output + y * pitch, width * sizeof(uint32_t));
+    }
+}
+
+static void restore_frame(GB_gameboy_t *gb, const uint32_t *retained)
+{
+    unsigned width = GB_get_screen_width(gb);
+    unsigned height = GB_get_screen_height(gb);
+    unsigned pitch = GB_get_screen_pitch(gb);
+    uint32_t *output = GB_get_pixels_output(gb);
+    for (unsigned y = 0; y < height; y++) {
+        memcpy(output + y * pitch, retained + y * width, width * sizeof(uint32_t));
+    }
+}
+
 static void vblank1(GB_gameboy_t *gb, GB_vblank_type_t type)
 {
     if (type == GB_VBLANK_TYPE_REPEAT) {
-        memcpy(GB_get_pixels_output(gb),
-               retained_frame_1,
-               GB_get_screen_width(gb) * GB_get_screen_height(gb) * sizeof(uint32_t));
+        restore_frame(gb, retained_frame_1);
     }
     vblank1_occurred = true;
 }
@@ -272,9 +303,7 @@ static void vblank1(GB_gameboy_t *gb, GB_vblank_type_t type)
 static void vblank2(GB_gameboy_t *gb, GB_vblank_type_t type)
 {
     if (type == GB_VBLANK_TYPE_REPEAT) {
-        memcpy(GB_get_pixels_output(gb),
-               retained_frame_2,
-               GB_get_screen_width(gb) * GB_get_screen_height(gb) * sizeof(uint32_t));
+        restore_frame(gb, retained_frame_2);
     }
     vblank2_occurred = true;
 }
@@ -282,18 +311,14 @@ static void vblank2(GB_gameboy_t *gb, GB_vblank_type_t type)
 static void lcd_status_change_1(GB_gameboy_t *gb, bool on)
 {
     if (!on) {
-        memcpy(retained_frame_1,
-               GB_get_pixels_output(gb),
-               GB_get_screen_width(gb) * GB_get_screen_height(gb) * sizeof(uint32_t));
+        retain_frame(gb, retained_frame_1);
     }
 }
 
 static void lcd_status_change_2(GB_gameboy_t *gb, bool on)
 {
     if (!on) {
-        memcpy(retained_frame_2,
-               GB_get_pixels_output(gb),
-               GB_get_screen_width(gb) * GB_get_screen_height(gb) * sizeof(uint32_t));
+        retain_frame(gb, retained_frame_2);
     }
 }
 
@@ -675,7 +700,7 @@ static void init_for_current_model(unsigned id)
 #else
     GB_set_sample_rate(&gameboy[i], GB_get_clock_rate(&gameboy[i]) / 2);
 #endif
-    GB_apu_set_sample_callback(&gameboy[i], audio_callback);
+    GB_apu_set_sample_buffer(&gameboy[i], audio_blocks[i], AUDIO_BLOCK_SIZE, audio_callback);
     GB_set_rumble_callback(&gameboy[i], rumble_callback);
 
     /* todo: attempt to make these more generic */
@@ -1243,9 +1268,7 @@ void retro_init(void)
 void retro_deinit(void)
 {
     free(frame_buf);
-    free(frame_buf_copy);
     frame_buf = NULL;
-    frame_buf_copy = NULL;
 
     free_output_audio_buffer();
 
@@ -1362,6 +1385,22 @@ void retro_reset(void)
     geometry_updated = true;
 }
 
+/* The layout and the border mode might have changed, so this is done every frame */
+static void set_pixels_outputs(void)
+{
+    unsigned width = GB_get_screen_width(&gameboy[0]);
+    unsigned height = GB_get_screen_height(&gameboy[0]);
+    for (unsigned i = 0; i < emulated_devices; i++) {
+        if (screen_layout == LAYOUT_LEFT_RIGHT) {
+            /* Render the devices side by side into the same frame, so it can be passed as is */
+            GB_set_pixels_output_with_pitch(&gameboy[i], frame_buf + width * i, width * emulated_devices);
+        }
+        else {
+            GB_set_pixels_output(&gameboy[i], frame_buf + width * height * i);
+        }
+    }
+}
+
 void retro_run(void)
 {
 
@@ -1385,6 +1424,8 @@ void retro_run(void)
     if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated) {
         check_variables();
     }
+    
+    set_pixels_outputs();
 
     if (emulated_devices == 2) {
         GB_update_keys_status(&gameboy[0], 0);
@@ -1423,17 +1464,7 @@ void retro_run(void)
                      GB_get_screen_width(&gameboy[0]) * sizeof(uint32_t));
         }
         else if (screen_layout == LAYOUT_LEFT_RIGHT) {
-            unsigned pitch = GB_get_screen_width(&gameboy[0]) * emulated_devices;
-            unsigned pixels_per_device = GB_get_screen_width(&gameboy[0]) * GB_get_screen_height(&gameboy[0]);
-            for (int y = 0; y < GB_get_screen_height(&gameboy[0]); y++) {
-                for (unsigned i = 0; i < emulated_devices; i++) {
-                    memcpy(frame_buf_copy + y * pitch + GB_get_screen_width(&gameboy[0]) * i,
-                           frame_buf + pixels_per_device * i + y * GB_get_screen_width(&gameboy[0]),
-                           GB_get_screen_width(&gameboy[0]) * sizeof(uint32_t));
-                }
-            }
-
-            video_cb(frame_buf_copy, GB_get_screen_width(&gameboy[0]) * emulated_devices, GB_get_screen_height(&gameboy[0]), GB_get_screen_width(&gameboy[0]) * emulated_devices * sizeof(uint32_t));
+            video_cb(frame_buf, GB_get_screen_width(&gameboy[0]) * emulated_devices, GB_get_screen_height(&gameboy[0]), GB_get_screen_width(&gameboy[0]) * emulated_devices * sizeof(uint32_t));
         }
     }
     else {
@@ -1443,6 +1474,9 @@ void retro_run(void)
                  GB_get_screen_width(&gameboy[0]) * sizeof(uint32_t));
     }
 
+    for (unsigned i = 0; i < emulated_devices; i++) {
+        GB_apu_flush_sample_buffer(&gameboy[i]);
+    }
     upload_output_audio_buffer();
     initialized = true;
 }
@@ -1561,10 +1595,8 @@ bool retro_load_game_special(unsigned type, const struct retro_game_info *info,
     check_variables();
 
     frame_buf = (uint32_t*)malloc(emulated_devices * MAX_VIDEO_PIXELS * sizeof(uint32_t));
-    frame_buf_copy = (uint32_t*)malloc(emulated_devices * MAX_VIDEO_PIXELS * sizeof(uint32_t));
 
     memset(frame_buf, 0, emulated_devices * MAX_VIDEO_PIXELS * sizeof(uint32_t));
-    memset(frame_buf_copy, 0, emulated_devices * MAX_VIDEO_PIXELS * sizeof(uint32_t));
 
     enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_XRGB8888;
     if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt)) {